@@ -21,12 +21,14 @@ class DoryConnectionConan(ConanFile):
         "fPIC": [True, False],
         "log_level": ["TRACE", "DEBUG", "INFO", "WARN", "ERROR", "CRITICAL", "OFF"],
         "lto": [True, False],
+        "qp_ex": [True, False],
     }
     default_options = {
         "shared": False,
         "fPIC": True,
         "lto": True,
         "log_level": "INFO",
+        "qp_ex": False,
         "dory-ctrl:log_level": "OFF"
     }
     generators = "cmake"
@@ -40,6 +42,7 @@ class DoryConnectionConan(ConanFile):
         self.python_requires["dory-compiler-options"].module.set_options(cmake)
 
         cmake.definitions["DORY_LTO"] = str(self.options.lto).upper()
+        cmake.definitions["DORY_QP_EX"] = str(self.options.qp_ex).upper()
         cmake.definitions["SPDLOG_ACTIVE_LEVEL"] = "SPDLOG_LEVEL_{}".format(
             self.options.log_level
         )
@@ -52,22 +52,25 @@ ConnectionExchanger::ConnectionExchanger(int my_id, std::vector<int> remote_ids,
 void ConnectionExchanger::configure(int proc_id, std::string const& pd,
                                     std::string const& mr,
                                     std::string send_cq_name,
-                                    std::string recv_cq_name) {
-  configure_with_cm(proc_id, pd, mr, send_cq_name, recv_cq_name);
+                                    std::string recv_cq_name,
+                                    int send_depth) {
+  configure_with_cm(proc_id, pd, mr, send_cq_name, recv_cq_name, send_depth);
 }
 
 void ConnectionExchanger::configure_all(std::string const& pd,
                                         std::string const& mr,
                                         std::string send_cq_name,
-                                        std::string recv_cq_name) {
-  configure_all_with_cm(pd, mr, send_cq_name, recv_cq_name);
+                                        std::string recv_cq_name,
+                                        int send_depth) {
+  configure_all_with_cm(pd, mr, send_cq_name, recv_cq_name, send_depth);
 }
 
 
 void ConnectionExchanger::configure_with_cm(int proc_id, std::string const& pd,
                                     std::string const& mr,
                                     std::string send_cq_name,
-                                    std::string recv_cq_name) {
+                                    std::string recv_cq_name,
+                                    int send_depth) {
   rcs.insert(
       std::pair<int, ReliableConnection>(proc_id, ReliableConnection(cb)));
 
@@ -75,6 +78,7 @@ void ConnectionExchanger::configure_with_cm(int proc_id, std::string const& pd,
 
   rc.bindToPD(pd);
   rc.bindToMR(mr);
+  rc.setSendDepth(send_depth);
   /*Quand on utilise le CM, on doit créer la qp avec rdma_qp après avoir reçu l'event rdma
   Du coup, la QP de rc sera crée plus tard*/
   rc.associateWithCQ_for_cm_prel(send_cq_name, recv_cq_name);
@@ -83,9 +87,10 @@ void ConnectionExchanger::configure_with_cm(int proc_id, std::string const& pd,
 void ConnectionExchanger::configure_all_with_cm(std::string const& pd,
                                         std::string const& mr,
                                         std::string send_cq_name,
-                                        std::string recv_cq_name) { 
+                                        std::string recv_cq_name,
+                                        int send_depth) { 
   for (auto const& id : remote_ids) {
-    configure_with_cm(id, pd, mr, send_cq_name, recv_cq_name);
+    configure_with_cm(id, pd, mr, send_cq_name, recv_cq_name, send_depth);
   }
 }
 
@@ -34,21 +34,27 @@ class ConnectionExchanger {
  public:
   ConnectionExchanger(int my_id, std::vector<int> remote_ids, ControlBlock& cb);
 
+  // `send_depth`: depth of the send queue of the QPs (see
+  // ReliableConnection::setSendDepth)
   void configure(int proc_id, std::string const& pd, std::string const& mr,
-                 std::string send_cp_name, std::string recv_cp_name);
+                 std::string send_cp_name, std::string recv_cp_name,
+                 int send_depth = ReliableConnection::WRDepth);
 
   void configure_all(std::string const& pd, std::string const& mr,
-                     std::string send_cp_name, std::string recv_cp_name);
+                     std::string send_cp_name, std::string recv_cp_name,
+                     int send_depth = ReliableConnection::WRDepth);
 
   void configure_with_cm(int proc_id, std::string const& pd,
                                       std::string const& mr,
                                       std::string send_cq_name,
-                                      std::string recv_cq_name);
+                                      std::string recv_cq_name,
+                                      int send_depth = ReliableConnection::WRDepth);
     
   void configure_all_with_cm( std::string const& pd,
                               std::string const& mr,
                               std::string send_cq_name,
-                              std::string recv_cq_name);
+                              std::string recv_cq_name,
+                              int send_depth = ReliableConnection::WRDepth);
 
   void addLoopback(std::string const& pd, std::string const& mr,
                    std::string send_cq_name, std::string recv_cq_name);
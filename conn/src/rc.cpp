@@ -8,7 +8,12 @@
 namespace dory {
 
 ReliableConnection::ReliableConnection(ControlBlock &cb)
-    : cb{cb}, pd{nullptr}, LOGGER_INIT(logger, "RC") {
+    : cb{cb},
+      pd{nullptr},
+      qpx{nullptr},
+      max_inline{0},
+      send_depth{WRDepth},
+      LOGGER_INIT(logger, "RC") {
   memset(&create_attr, 0, sizeof(struct ibv_qp_init_attr));
   create_attr.qp_type = IBV_QPT_RC;
   create_attr.cap.max_send_wr = WRDepth;
@@ -22,6 +27,17 @@ void ReliableConnection::bindToPD(std::string pd_name) {
   pd = cb.pd(pd_name).get();
 }
 
+void ReliableConnection::setSendDepth(int depth) {
+  if (depth <= 0 || depth > cb.maxQPDepth()) {
+    throw std::runtime_error("The send queue cannot be " +
+                             std::to_string(depth) + " deep (the device " +
+                             "allows " + std::to_string(cb.maxQPDepth()) + ")");
+  }
+
+  create_attr.cap.max_send_wr = static_cast<uint32_t>(depth);
+  send_depth = depth;
+}
+
 void ReliableConnection::bindToMR(std::string mr_name) { mr = cb.mr(mr_name); }
 
 // TODO(Kristian): creation of qp should be rather separated?
@@ -43,6 +59,7 @@ void ReliableConnection::associateWithCQ(std::string send_cp_name,
                                std::string(std::strerror(errno)));
     }
   });
+  query_caps();
   //std :: cout << "QP created with ibv_create_qp() ==> Be careful about its state !" << std :: endl;
 }
 
@@ -60,10 +77,42 @@ void ReliableConnection::associateWithCQ_for_cm_prel(std::string send_cp_name,
 
 /*Une fois le connection manager prêt, on peut enfin créer une qp
 C'est comme ça qu'on évite de devoir nous même utiliser les ibv_modify_qp()*/
+// With DORY_QP_EX, asks for a QP that also takes the ibv_wr_* API, and falls
+// back to a regular one if the provider does not support it
+int ReliableConnection::create_cm_qp() {
+  qpx = nullptr;
+
+#ifdef DORY_QP_EX
+  struct ibv_qp_init_attr_ex attr_ex;
+  memset(&attr_ex, 0, sizeof(attr_ex));
+  attr_ex.qp_context = create_attr.qp_context;
+  attr_ex.send_cq = create_attr.send_cq;
+  attr_ex.recv_cq = create_attr.recv_cq;
+  attr_ex.cap = create_attr.cap;
+  attr_ex.qp_type = create_attr.qp_type;
+  attr_ex.sq_sig_all = create_attr.sq_sig_all;
+  attr_ex.pd = pd;
+  attr_ex.comp_mask = IBV_QP_INIT_ATTR_PD | IBV_QP_INIT_ATTR_SEND_OPS_FLAGS;
+  attr_ex.send_ops_flags = IBV_QP_EX_WITH_RDMA_WRITE | IBV_QP_EX_WITH_RDMA_READ;
+
+  if (rdma_create_qp_ex(cm_id, &attr_ex) == 0) {
+    qpx = ibv_qp_to_qp_ex(cm_id->qp);
+    return 0;
+  }
+
+  LOGGER_WARN(logger,
+              "Could not create an extended QP ({}), falling back to "
+              "ibv_post_send",
+              std::strerror(errno));
+#endif
+
+  return rdma_create_qp(cm_id, pd, &create_attr);
+}
+
 void ReliableConnection::associateWithCQ_for_cm() {
   //cm_id->verbs = pd->context; 
 
-  int ret = rdma_create_qp(cm_id, pd, &create_attr);
+  int ret = create_cm_qp();
 
   if (ret) {
     printf("Failed to create QP due to errno: %s\n", strerror(errno));
@@ -80,6 +129,7 @@ void ReliableConnection::associateWithCQ_for_cm() {
       throw std::runtime_error("Could not query device: " + std::string(std::strerror(errno)));
     }
   });
+  query_caps();
   //LOGGER_INFO(logger, "QP successfully created (with cm)! ");
 
   // Copié-collé de la fin de la fonction connect()
@@ -215,6 +265,10 @@ bool ReliableConnection::changeRightsIfNeeded(
 
 bool ReliableConnection::post_send(ibv_send_wr &wr, bool print) {
   //printf("ATTENTION : post_send() appelé\n");
+  if (qpx != nullptr) {
+    return post_send_ex(wr);
+  }
+
   struct ibv_send_wr *bad_wr = nullptr;
 
   auto ret = ibv_post_send(uniq_qp.get(), &wr, &bad_wr);
@@ -241,6 +295,47 @@ bool ReliableConnection::post_send(ibv_send_wr &wr, bool print) {
   return true;
 }
 
+// Same WR list, through the ibv_wr_* API of the extended QP (the old and the
+// new posting API are not mixed on a QP)
+bool ReliableConnection::post_send_ex(ibv_send_wr &wr) {
+  ibv_wr_start(qpx);
+
+  for (auto w = &wr; w != nullptr; w = w->next) {
+    qpx->wr_id = w->wr_id;
+    qpx->wr_flags = w->send_flags;
+
+    if (w->opcode == IBV_WR_RDMA_READ) {
+      ibv_wr_rdma_read(qpx, w->wr.rdma.rkey, w->wr.rdma.remote_addr);
+    } else {
+      ibv_wr_rdma_write(qpx, w->wr.rdma.rkey, w->wr.rdma.remote_addr);
+    }
+
+    if (w->send_flags & IBV_SEND_INLINE) {
+      struct ibv_data_buf bufs[SGEDepth];
+      for (int i = 0; i < w->num_sge; i++) {
+        bufs[i].addr = reinterpret_cast<void *>(w->sg_list[i].addr);
+        bufs[i].length = w->sg_list[i].length;
+      }
+      ibv_wr_set_inline_data_list(qpx, static_cast<size_t>(w->num_sge), bufs);
+    } else {
+      ibv_wr_set_sge_list(qpx, static_cast<size_t>(w->num_sge), w->sg_list);
+    }
+  }
+
+  auto ret = ibv_wr_complete(qpx);
+  if (ret == ENOMEM) {
+    LOGGER_DEBUG(logger, "Send queue full, got bad wr with id: {}", wr.wr_id);
+    return false;
+  }
+
+  if (ret != 0) {
+    throw std::runtime_error("Error due to driver misuse during posting: " +
+                             std::string(std::strerror(ret)));
+  }
+
+  return true;
+}
+
 bool ReliableConnection::postSendSingleCached(RdmaReq req, uint64_t req_id,
                                               void *buf, uint32_t len,
                                               uintptr_t remote_addr,
@@ -252,7 +347,7 @@ bool ReliableConnection::postSendSingleCached(RdmaReq req, uint64_t req_id,
   wr_cached->wr_id = req_id;
   wr_cached->opcode = static_cast<enum ibv_wr_opcode>(req);
 
-  if (wr_cached->opcode == IBV_WR_RDMA_WRITE && len <= MaxInlining) {
+  if (wr_cached->opcode == IBV_WR_RDMA_WRITE && len <= max_inline) {
     wr_cached->send_flags |= IBV_SEND_INLINE;
   } else {
     wr_cached->send_flags &= ~static_cast<unsigned int>(IBV_SEND_INLINE);
@@ -261,26 +356,7 @@ bool ReliableConnection::postSendSingleCached(RdmaReq req, uint64_t req_id,
   wr_cached->wr.rdma.remote_addr = remote_addr;
   wr_cached->wr.rdma.rkey = rconn.rci.rkey;
 
-  struct ibv_send_wr *bad_wr = nullptr;
-  
-  auto ret = ibv_post_send(uniq_qp.get(), wr_cached.get(), &bad_wr);
-  if (bad_wr != nullptr) {
-    LOGGER_DEBUG(logger, "Got bad wr with id: {}", bad_wr->wr_id);
-    return false;
-    // throw std::runtime_error(
-    //     "Error encountered during posting in some work request");
-  }
-
-  if (print){
-    std::cout << "In postSendSingleCached, we just sent to addr : "<< wr_cached->wr.rdma.remote_addr << std::endl;
-  }
-
-  if (ret != 0) {
-    throw std::runtime_error("Error due to driver misuse during posting: " +
-                             std::string(std::strerror(errno)));
-  }
-
-  return true;
+  return post_send(*wr_cached, print);
 }
 
 bool ReliableConnection::postSendSingle(RdmaReq req, uint64_t req_id, void *buf,
@@ -306,11 +382,39 @@ bool ReliableConnection::postSendSingle(RdmaReq req, uint64_t req_id, void *buf,
       .lkey(lkey)
       .remote_addr(remote_addr)
       .rkey(rconn.rci.rkey)
+      .inline_limit(max_inline)
       .build(wr, sg);
 
   return post_send(wr, print);
 }
 
+bool ReliableConnection::postWrite(uint64_t req_id, void *buf, uint32_t len,
+                                   uintptr_t remote_addr, bool signaled) {
+  return post_send(write_wr.fill(req_id, buf, len, remote_addr, signaled));
+}
+
+bool ReliableConnection::postSendGather(RdmaReq req, uint64_t req_id,
+                                        struct ibv_sge *sg_list, int num_sge,
+                                        uintptr_t remote_addr, bool signaled) {
+  if (num_sge > SGEDepth) {
+    throw std::runtime_error("Too many SGEs for a single WR");
+  }
+
+  struct ibv_send_wr wr;
+
+  SendWrBuilder()
+      .req(req)
+      .signaled(signaled)
+      .req_id(req_id)
+      .sg_list(sg_list, num_sge)
+      .remote_addr(remote_addr)
+      .rkey(rconn.rci.rkey)
+      .inline_limit(max_inline)
+      .build(wr);
+
+  return post_send(wr);
+}
+
 void ReliableConnection::reconnect() { 
   printf("ATTENTION appel d'une fonction de RC interdite: reconnect() ==> does nothing \n");
   //connect(rconn); 
@@ -355,6 +459,29 @@ void ReliableConnection::query_qp(ibv_qp_attr &qp_attr,
   ibv_query_qp(uniq_qp.get(), &qp_attr, attr_mask, &init_attr);
 }
 
+// The provider may grant more (or less) inline data than asked for at
+// creation, the WRs are built against what the QP actually takes
+void ReliableConnection::query_caps() {
+  struct ibv_qp_attr attr;
+  struct ibv_qp_init_attr init_attr;
+  memset(&init_attr, 0, sizeof(init_attr));
+
+  if (ibv_query_qp(uniq_qp.get(), &attr, IBV_QP_CAP, &init_attr) != 0) {
+    // What was asked at creation is the safe guess for the depth
+    max_inline = 0;
+    send_depth = static_cast<int>(create_attr.cap.max_send_wr);
+    LOGGER_WARN(logger, "Could not query the capabilities of the QP: {}",
+                std::strerror(errno));
+  } else {
+    max_inline = init_attr.cap.max_inline_data;
+    send_depth = static_cast<int>(attr.cap.max_send_wr);
+    LOGGER_INFO(logger, "QP takes up to {} bytes of inline data, {} WRs",
+                max_inline, send_depth);
+  }
+
+  write_wr.setInlineLimit(max_inline);
+}
+
 int ReliableConnection::query_qp_state(){
   struct ibv_qp_attr attr;
   struct ibv_qp_init_attr init_attr;
@@ -435,6 +562,7 @@ void ReliableConnection ::setRemoteSetup(const void *network_data) {
 
   // 20 Bytes of offset to get KEY
   memcpy(&rconn.rci.rkey, static_cast<const uint8_t*>(network_data) + 20, 4);
+  write_wr.setKeys(mr.lkey, rconn.rci.rkey);
   /*
   printf("\n============ (received) remote setup ===============\n");
   printf("===== ADDRESS : %p\n", reinterpret_cast<void*>(rconn.rci.buf_addr));
@@ -483,7 +611,7 @@ void ReliableConnection :: reset_with_cm(ControlBlock :: MemoryRights rights){
   rdma_destroy_qp(cm_id);
 
   //creating the qp 
-  auto ret = rdma_create_qp(cm_id, pd, &create_attr);
+  auto ret = create_cm_qp();
 
   if (ret) {
     printf("Failed to create QP due to errno: %s\n", strerror(errno));
@@ -498,6 +626,7 @@ void ReliableConnection :: reset_with_cm(ControlBlock :: MemoryRights rights){
       throw std::runtime_error("Could not query device: " + std::string(std::strerror(errno)));
     }
   });
+  query_caps();
 
   //toujours dans l'état init, on en profite pour changer les access flags de la qp
   set_init_with_cm(rights);
@@ -519,6 +648,7 @@ void ReliableConnection :: setRCWithTofino(bypass::connection *conn){
       throw std::runtime_error("Could not query device: " + std::string(std::strerror(errno)));
     }
   });
+  query_caps();
 
   std::cout << "uniq_qp set up " << std::endl;
 
@@ -530,6 +660,7 @@ void ReliableConnection :: setRCWithTofino(bypass::connection *conn){
   rconn.rci.buf_addr = (uintptr_t)conn->remote_buffer_info.address;
   rconn.rci.buf_size = conn->remote_buffer_info.length;
   rconn.rci.rkey = conn->remote_buffer_info.stag.local_stag;
+  write_wr.setKeys(mr.lkey, rconn.rci.rkey);
 
   // Copié-collé de la fin de la fonction connect() du code source, pour pouvoir utiliser SendSingleCached
   struct ibv_send_wr *wr_ = reinterpret_cast<ibv_send_wr *>( aligned_alloc(64, roundUp(sizeof(ibv_send_wr), 64) + sizeof(ibv_sge)));
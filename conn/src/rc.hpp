@@ -12,6 +12,7 @@
 #include <dory/extern/rdmacm.hpp>
 
 #include "bypass.h"
+#include "wr-template.hpp"
 
 namespace dory {
 struct RemoteConnection {
@@ -98,6 +99,10 @@ class ReliableConnection {
 
   void bindToPD(std::string pd_name);
 
+  // Depth of the send queue of the QP (WRDepth by default), to set before the
+  // QP is created. Throws if the device does not allow it.
+  void setSendDepth(int depth);
+
   void bindToMR(std::string mr_name);
 
   void associateWithCQ(std::string send_cp_name, std::string recv_cp_name);
@@ -128,12 +133,35 @@ class ReliableConnection {
   bool postSendSingle(RdmaReq req, uint64_t req_id, void *buf, uint32_t len,
                       uint32_t lkey, uintptr_t remote_addr, bool print=false);
 
+  // RDMA write from the registered buffer, posted from a pre-built WR (see
+  // WriteTemplate). The WR only generates a WC if `signaled`: the WRs of a QP
+  // complete in order, so the WC of a signaled WR also stands for the
+  // unsignaled ones posted before it. The caller must signal often enough for
+  // the send queue not to fill up with unsignaled WRs.
+  bool postWrite(uint64_t req_id, void *buf, uint32_t len,
+                 uintptr_t remote_addr, bool signaled);
+
+  // Single WR whose payload is gathered from `num_sge` (<= SGEDepth) local
+  // buffers, each carrying its own lkey
+  bool postSendGather(RdmaReq req, uint64_t req_id, struct ibv_sge *sg_list,
+                      int num_sge, uintptr_t remote_addr,
+                      bool signaled = true);
+
   bool pollCqIsOK(CQ cq, std::vector<struct ibv_wc> &entries);
 
   RemoteConnection remoteInfo() const;
 
   uintptr_t remoteBuf() const { return rconn.rci.buf_addr; }
 
+  // Writes up to this size are posted with IBV_SEND_INLINE: the payload is
+  // copied into the WR when posting, the NIC does not read the local buffer
+  // afterwards (queried from the QP once created, MaxInlining is only asked)
+  uint32_t inlineLimit() const { return max_inline; }
+
+  // WRs the send queue holds, as queried from the QP once created (the
+  // provider may round the asked depth up)
+  int sendDepth() const { return send_depth; }
+
   const ControlBlock::MemoryRegion &get_mr() const { return mr; }
 
   void query_qp(ibv_qp_attr &qp_attr, ibv_qp_init_attr &init_attr,
@@ -180,6 +208,9 @@ class ReliableConnection {
 
  private:
   bool post_send(ibv_send_wr &wr, bool print=false);
+  bool post_send_ex(ibv_send_wr &wr);
+  void query_caps();
+  int create_cm_qp();
 
   static void wr_deleter(struct ibv_send_wr *wr) { free(wr); }
 
@@ -209,6 +240,13 @@ class ReliableConnection {
   
   RemoteConnection rconn;
   deleted_unique_ptr<struct ibv_send_wr> wr_cached;
+
+  WriteTemplate write_wr;
+  // Set when the QP was created with the extended API (built with
+  // DORY_QP_EX and supported by the provider): every WR goes through ibv_wr_*
+  struct ibv_qp_ex *qpx;
+  uint32_t max_inline;
+  int send_depth;
   
   LOGGER_DECL(logger);
 
@@ -46,9 +46,33 @@ class SendWrBuilder {
     next_ = v;
     return *this;
   }
+  // Largest payload posted inline, the limit of the QP
+  SendWrBuilder& inline_limit(uint32_t v) {
+    inline_limit_ = v;
+    return *this;
+  }
+  // Gather list, used instead of buf/len/lkey by build(wr)
+  SendWrBuilder& sg_list(ibv_sge* v, int num) {
+    sg_list_ = v;
+    num_sge_ = num;
+    return *this;
+  }
 
   void build(ibv_send_wr& wr, ibv_sge& sg) const { fill(wr, sg); }
 
+  void build(ibv_send_wr& wr) const {
+    memset(&wr, 0, sizeof(ibv_send_wr));
+
+    uint32_t total_len = 0;
+    for (int i = 0; i < num_sge_; i++) {
+      total_len += sg_list_[i].length;
+    }
+
+    wr.sg_list = sg_list_;
+    wr.num_sge = num_sge_;
+    fill_common(wr, total_len);
+  }
+
   dory::deleted_unique_ptr<struct ibv_send_wr> build() const {
     struct ibv_sge* sg = reinterpret_cast<ibv_sge*>(malloc(sizeof(ibv_sge)));
 
@@ -68,9 +92,13 @@ class SendWrBuilder {
     sg.length = len_;
     sg.lkey = lkey_;
 
-    wr.wr_id = req_id_;
     wr.sg_list = &sg;
     wr.num_sge = 1;
+    fill_common(wr, len_);
+  }
+
+  void fill_common(ibv_send_wr& wr, uint32_t total_len) const {
+    wr.wr_id = req_id_;
     wr.opcode = static_cast<enum ibv_wr_opcode>(req_);  // TODO
     wr.next = next_;
 
@@ -78,8 +106,7 @@ class SendWrBuilder {
       wr.send_flags |= IBV_SEND_SIGNALED;
     }
 
-    if (wr.opcode == IBV_WR_RDMA_WRITE &&
-        len_ <= ReliableConnection::MaxInlining) {
+    if (wr.opcode == IBV_WR_RDMA_WRITE && total_len <= inline_limit_) {
       wr.send_flags |= IBV_SEND_INLINE;
     }
 
@@ -103,7 +130,10 @@ class SendWrBuilder {
   uint32_t lkey_;
   uintptr_t remote_addr_;
   uint32_t rkey_;
-  ibv_send_wr* next_;
+  ibv_send_wr* next_ = nullptr;
+  ibv_sge* sg_list_ = nullptr;
+  int num_sge_ = 0;
+  uint32_t inline_limit_ = ReliableConnection::MaxInlining;
 };
 
 class SendWrListBuilder {
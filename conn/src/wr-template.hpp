@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include <dory/extern/ibverbs.hpp>
+
+namespace dory {
+/*RDMA write pré-construite pour une connexion : l'opcode et les clés sont
+remplis une fois pour toutes, fill() ne change que l'adresse locale, la
+longueur, l'adresse distante, le wr_id et les flags avant chaque post.*/
+class WriteTemplate {
+ public:
+  WriteTemplate() : max_inline{0} {
+    memset(&wr, 0, sizeof(wr));
+    memset(&sge, 0, sizeof(sge));
+
+    wr.opcode = IBV_WR_RDMA_WRITE;
+    wr.num_sge = 1;
+  }
+
+  // The keys are known once the connection is set up
+  void setKeys(uint32_t lkey, uint32_t rkey) {
+    sge.lkey = lkey;
+    wr.wr.rdma.rkey = rkey;
+  }
+
+  // What the QP takes inline (ReliableConnection::inlineLimit)
+  void setInlineLimit(uint32_t limit) { max_inline = limit; }
+
+  inline struct ibv_send_wr &fill(uint64_t wr_id, void *buf, uint32_t len,
+                                  uintptr_t remote_addr, bool signaled) {
+    sge.addr = reinterpret_cast<uintptr_t>(buf);
+    sge.length = len;
+
+    // The connection may have moved since the last post
+    wr.sg_list = &sge;
+    wr.wr_id = wr_id;
+    wr.wr.rdma.remote_addr = remote_addr;
+    unsigned int flags = 0;
+    if (signaled) {
+      flags |= IBV_SEND_SIGNALED;
+    }
+    if (len <= max_inline) {
+      flags |= IBV_SEND_INLINE;
+    }
+    wr.send_flags = flags;
+
+    return wr;
+  }
+
+ private:
+  struct ibv_send_wr wr;
+  struct ibv_sge sge;
+  uint32_t max_inline;
+};
+}  // namespace dory
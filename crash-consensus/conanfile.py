@@ -12,12 +12,14 @@ class DoryCrashConensusConan(ConanFile):
         "fPIC": [True, False],
         "lto": [True, False],
         "log_level": ["TRACE", "DEBUG", "INFO", "WARN", "ERROR", "CRITICAL", "OFF"],
+        "compact_slots": [True, False],
     }
     default_options = {
         "shared": False,
         "fPIC": True,
         "lto": True,
         "log_level": "INFO",
+        "compact_slots": False,
 
         "dory-ctrl:log_level": "INFO",
         "dory-connection:log_level": "INFO"
@@ -40,6 +42,7 @@ class DoryCrashConensusConan(ConanFile):
         self.python_requires["dory-compiler-options"].module.set_options(cmake)
         cmake.definitions["DORY_LTO"] = str(self.options.lto).upper()
         cmake.definitions['SPDLOG_ACTIVE_LEVEL'] = "SPDLOG_LEVEL_{}".format(self.options.log_level)
+        cmake.definitions["DORY_COMPACT_SLOTS"] = str(self.options.compact_slots).upper()
 
         cmake.configure(source_folder="src")
         cmake.build()
@@ -0,0 +1,158 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dory/crash-consensus.hpp>
+
+#include "helpers.hpp"
+#include "timers.h"
+
+/*Latence de propose avec un log durable (un fichier sur tmpfs/ext4, ou un
+device DAX), pour comparer les FlushPolicy. Affiche le coût du flush par
+entrée. En relançant le process sur le même fichier, le log reprend au FUO
+persisté.
+
+./main-st-durable <id> <payload size> <log path> <none|entry|batch|async>*/
+
+static constexpr size_t LogSize = 256UL * 1024 * 1024;
+
+void benchmark(int id, std::vector<int> remote_ids, int times, int payload_size,
+               std::string const& log_path, dory::FlushPolicy policy);
+
+int main(int argc, char* argv[]) {
+  if (argc < 5) {
+    throw std::runtime_error(
+        "Provide the id, the payload size, the log path and the flush policy");
+  }
+
+  constexpr int nr_procs = 3;
+  constexpr int minimum_id = 1;
+  int id = 0;
+  switch (argv[1][0]) {
+    case '1':
+      id = 1;
+      break;
+    case '2':
+      id = 2;
+      break;
+    case '3':
+      id = 3;
+      break;
+    default:
+      throw std::runtime_error("Invalid id");
+  }
+
+  int payload_size = atoi(argv[2]);
+  std::cout << "USING PAYLOAD SIZE = " << payload_size << std::endl;
+
+  std::string log_path(argv[3]);
+  std::cout << "USING LOG FILE = " << log_path << std::endl;
+
+  std::string p(argv[4]);
+  dory::FlushPolicy policy;
+  if (p == "none") {
+    policy = dory::FlushPolicy::None;
+  } else if (p == "entry") {
+    policy = dory::FlushPolicy::PerEntry;
+  } else if (p == "batch") {
+    policy = dory::FlushPolicy::PerBatch;
+  } else if (p == "async") {
+    policy = dory::FlushPolicy::Async;
+  } else {
+    throw std::runtime_error("Invalid flush policy");
+  }
+  std::cout << "USING FLUSH POLICY = " << p << std::endl;
+
+  // Build the list of remote ids
+  std::vector<int> remote_ids;
+  for (int i = 0, min_id = minimum_id; i < nr_procs; i++, min_id++) {
+    if (min_id == id) {
+      continue;
+    } else {
+      remote_ids.push_back(min_id);
+    }
+  }
+
+  const int times = 1000000;
+  benchmark(id, remote_ids, times, payload_size, log_path, policy);
+
+  while (true) {
+    std::this_thread::sleep_for(std::chrono::seconds(60));
+  }
+
+  return 0;
+}
+
+void benchmark(int id, std::vector<int> remote_ids, int times, int payload_size,
+               std::string const& log_path, dory::FlushPolicy policy) {
+  dory::ConsensusOptions options;
+  options.log_size = LogSize;
+  options.log_path = log_path;
+  options.flush_policy = policy;
+
+  dory::Consensus consensus(id, remote_ids, options);
+  consensus.commitHandler([]([[maybe_unused]] bool leader,
+                             [[maybe_unused]] uint8_t* buf,
+                             [[maybe_unused]] size_t len) {});
+
+  // Wait enough time for the consensus to become ready
+  std::cout << "Wait some time (" << (5 + id) << "seconds)" << std::endl;
+  std::this_thread::sleep_for(std::chrono::seconds(5 + id));
+
+  if (id == 1) {
+    TIMESTAMP_INIT;
+
+    std::vector<std::vector<uint8_t>> payloads(8192);
+    for (size_t i = 0; i < payloads.size(); i++) {
+      payloads[i].resize(payload_size + 1);
+      mkrndstr_ipa(payload_size, &(payloads[i][0]));
+    }
+
+    std::cout << "Started" << std::endl;
+
+    TIMESTAMP_T start, end;
+    GET_TIMESTAMP(start);
+
+    int proposed = 0;
+    for (int i = 0; i < times; i++) {
+      auto err = consensus.propose(&(payloads[i % 8192][0]), payload_size);
+      if (err != dory::ProposeError::NoError) {
+        std::cout << "Proposal failed with code " << static_cast<int>(err)
+                  << ", potential leader: " << consensus.potentialLeader()
+                  << std::endl;
+        break;
+      }
+      proposed++;
+    }
+
+    GET_TIMESTAMP(end);
+
+    if (proposed > 0) {
+      double elapsed_time = static_cast<double>(ELAPSED_NSEC(start, end));
+      std::cout << "Replicated " << proposed << " commands of size "
+                << payload_size << " bytes in " << elapsed_time << " ns"
+                << std::endl;
+      std::cout << "Average time per op = " << elapsed_time / proposed / 1000
+                << "µs" << std::endl;
+    }
+  } else {
+    // The followers flush what they receive, let them work for a while
+    std::this_thread::sleep_for(std::chrono::seconds(30));
+  }
+
+  auto stats = consensus.flushStats();
+  std::cout << "Flushed " << stats.bytes << " bytes in " << stats.flushes
+            << " flushes for " << stats.entries << " entries" << std::endl;
+  if (stats.entries > 0) {
+    std::cout << "Flush cost per entry = "
+              << static_cast<double>(stats.ns) /
+                     static_cast<double>(stats.entries)
+              << " ns" << std::endl;
+  }
+
+  exit(0);
+}
@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <dory/crash-consensus.hpp>
+
+#include "helpers.hpp"
+#include "timers.h"
+
+/*Latence de propose (médiane, 99e centile) pour des tailles de commande
+croissantes. Les writes de moins que la limite d'inline de la QP (affichée
+au démarrage par les RC, "QP takes up to N bytes of inline data") partent
+avec IBV_SEND_INLINE : la courbe montre à partir de quelle taille l'inline ne
+paie plus, sur la carte comme sur soft-RoCE.
+
+./main-st-inline-sweep <id> [max payload size] [proposals per size]*/
+
+void benchmark(int id, std::vector<int> remote_ids, int max_size, int times);
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    throw std::runtime_error("Provide the id of the process as argument");
+  }
+
+  constexpr int nr_procs = 3;
+  constexpr int minimum_id = 1;
+  int id = 0;
+  switch (argv[1][0]) {
+    case '1':
+      id = 1;
+      break;
+    case '2':
+      id = 2;
+      break;
+    case '3':
+      id = 3;
+      break;
+    default:
+      throw std::runtime_error("Invalid id");
+  }
+
+  int max_size = argc > 2 ? atoi(argv[2]) : 2048;
+  int times = argc > 3 ? atoi(argv[3]) : 100000;
+  if (max_size < 8 || times <= 0) {
+    throw std::runtime_error("Invalid payload size or number of proposals");
+  }
+  std::cout << "SWEEPING PAYLOAD SIZES UP TO " << max_size << ", " << times
+            << " PROPOSALS EACH" << std::endl;
+
+  // Build the list of remote ids
+  std::vector<int> remote_ids;
+  for (int i = 0, min_id = minimum_id; i < nr_procs; i++, min_id++) {
+    if (min_id == id) {
+      continue;
+    } else {
+      remote_ids.push_back(min_id);
+    }
+  }
+
+  benchmark(id, remote_ids, max_size, times);
+
+  while (true) {
+    std::this_thread::sleep_for(std::chrono::seconds(60));
+  }
+
+  return 0;
+}
+
+void benchmark(int id, std::vector<int> remote_ids, int max_size, int times) {
+  dory::Consensus consensus(id, remote_ids, 0, false, dory::ThreadBank::A);
+  consensus.commitHandler([]([[maybe_unused]] bool leader,
+                             [[maybe_unused]] uint8_t* buf,
+                             [[maybe_unused]] size_t len) {});
+
+  // Wait enough time for the consensus to become ready
+  std::cout << "Wait some time (" << (5 + id) << "seconds)" << std::endl;
+  std::this_thread::sleep_for(std::chrono::seconds(5 + id));
+
+  if (id != 1) {
+    return;
+  }
+
+  TIMESTAMP_INIT;
+
+  std::vector<uint8_t> payload(max_size + 1);
+  mkrndstr_ipa(max_size, &payload[0]);
+  std::vector<uint64_t> latencies(times);
+
+  std::cout << "size median_ns p99_ns" << std::endl;
+
+  // Finer steps around the usual inline limits
+  for (int size = 8; size <= max_size;
+       size += size < 128 ? 8 : size < 512 ? 32 : 256) {
+    for (int i = 0; i < times; i++) {
+      TIMESTAMP_T start, end;
+      GET_TIMESTAMP(start);
+      auto err = consensus.propose(&payload[0], size);
+      GET_TIMESTAMP(end);
+
+      if (err != dory::ProposeError::NoError) {
+        std::cout << "Proposal failed with code " << static_cast<int>(err)
+                  << ", potential leader: " << consensus.potentialLeader()
+                  << std::endl;
+        return;
+      }
+
+      latencies[i] = ELAPSED_NSEC(start, end);
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << size << " " << latencies[latencies.size() / 2] << " "
+              << latencies[latencies.size() * 99 / 100] << std::endl;
+  }
+}
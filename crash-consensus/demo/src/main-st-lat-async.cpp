@@ -0,0 +1,148 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <dory/crash-consensus.hpp>
+
+#include "helpers.hpp"
+#include "timers.h"
+
+/*Même mesure que main-st-lat, mais avec proposeAsync : chaque completion
+est associée à son ticket, on n'a plus besoin de reconstruire les latences
+à partir de proposedReplicatedRange()*/
+
+void benchmark(int id, std::vector<int> remote_ids, int times, int payload_size,
+               int outstanding_req, dory::ThreadBank threadBank);
+
+int main(int argc, char* argv[]) {
+  if (argc < 4) {
+    throw std::runtime_error("Provide the id of the process as argument");
+  }
+
+  constexpr int nr_procs = 3;
+  constexpr int minimum_id = 1;
+  int id = 0;
+  switch (argv[1][0]) {
+    case '1':
+      id = 1;
+      break;
+    case '2':
+      id = 2;
+      break;
+    case '3':
+      id = 3;
+      break;
+    default:
+      throw std::runtime_error("Invalid id");
+  }
+
+  int payload_size = atoi(argv[2]);
+  std::cout << "USING PAYLOAD SIZE = " << payload_size << std::endl;
+
+  int outstanding_req = atoi(argv[3]);
+  std::cout << "USING OUTSTANDING_REQ = " << outstanding_req << std::endl;
+
+  // Build the list of remote ids
+  std::vector<int> remote_ids;
+  for (int i = 0, min_id = minimum_id; i < nr_procs; i++, min_id++) {
+    if (min_id == id) {
+      continue;
+    } else {
+      remote_ids.push_back(min_id);
+    }
+  }
+
+  const int times =
+      static_cast<int>(1.5 * 1024) * 1024 * 1024 / (payload_size + 64);
+  benchmark(id, remote_ids, times, payload_size, outstanding_req,
+            dory::ThreadBank::A);
+
+  while (true) {
+    std::this_thread::sleep_for(std::chrono::seconds(60));
+  }
+
+  return 0;
+}
+
+void benchmark(int id, std::vector<int> remote_ids, int times, int payload_size,
+               int outstanding_req, dory::ThreadBank threadBank) {
+  dory::Consensus consensus(id, remote_ids, outstanding_req, false, threadBank);
+  consensus.commitHandler([]([[maybe_unused]] bool leader,
+                             [[maybe_unused]] uint8_t* buf,
+                             [[maybe_unused]] size_t len) {});
+
+  // Wait enough time for the consensus to become ready
+  std::cout << "Wait some time (" << (5 + id) << "seconds)" << std::endl;
+  std::this_thread::sleep_for(std::chrono::seconds(5 + id));
+
+  if (id == 1) {
+    TIMESTAMP_INIT;
+
+    std::vector<std::vector<uint8_t>> payloads(8192);
+    for (size_t i = 0; i < payloads.size(); i++) {
+      payloads[i].resize(payload_size + 1);
+      mkrndstr_ipa(payload_size, &(payloads[i][0]));
+    }
+
+    // Tickets start at 1 and are consecutive as long as no proposal fails
+    std::vector<TIMESTAMP_T> timestamps_start(times + 1);
+    std::vector<TIMESTAMP_T> timestamps_end(times + 1);
+    std::vector<bool> committed(times + 1, false);
+
+    consensus.completionHandler([&](uint64_t ticket, bool ok) {
+      GET_TIMESTAMP(timestamps_end[ticket]);
+      committed[ticket] = ok;
+    });
+
+    std::cout << "Started" << std::endl;
+
+    uint64_t ticket = 0;
+    for (int i = 1; i <= times; i++) {
+      GET_TIMESTAMP(timestamps_start[i]);
+
+      auto err = consensus.proposeAsync(&(payloads[i % 8192][0]), payload_size,
+                                        ticket);
+      if (err != dory::ProposeError::NoError) {
+        std::cout << "Proposal failed with code " << static_cast<int>(err)
+                  << ", potential leader: " << consensus.potentialLeader()
+                  << std::endl;
+        break;
+      }
+
+      consensus.poll();
+    }
+
+    if (ticket != 0) {
+      consensus.wait(ticket);
+    }
+
+    std::ofstream dump;
+    dump.open("dump-st-async-" + std::to_string(payload_size) + "-" +
+              std::to_string(outstanding_req) + ".txt");
+
+    int n_committed = 0;
+    for (uint64_t t = 1; t <= ticket; t++) {
+      if (committed[t]) {
+        n_committed++;
+        dump << ELAPSED_NSEC(timestamps_start[t], timestamps_end[t]) << "\n";
+      }
+    }
+
+    dump.close();
+
+    if (n_committed > 0) {
+      double elapsed_time = static_cast<double>(
+          ELAPSED_NSEC(timestamps_start[1], timestamps_end[ticket]));
+      std::cout << "Replicated " << n_committed << " commands of size "
+                << payload_size << " bytes in " << elapsed_time << " ns"
+                << std::endl;
+      std::cout << "Average time per op = " << elapsed_time / n_committed / 1000
+                << "µs" << std::endl;
+    }
+
+    exit(0);
+  }
+}
@@ -127,8 +127,7 @@ void benchmark(int id, std::vector<int> remote_ids, int times, int payload_size,
             break;
 
           case dory::ProposeError::SlowPathLogRecycled:
-            std::cout << "Log recycled, waiting a bit..." << std::endl;
-            std::this_thread::sleep_for(std::chrono::seconds(1));
+            std::cout << "Log recycled" << std::endl;
             break;
 
           case dory::ProposeError::MutexUnavailable:
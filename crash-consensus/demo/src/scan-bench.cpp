@@ -0,0 +1,127 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "../../src/log/log-scan.hpp"
+
+/*Débit des noyaux de dory::scan sur un buffer à zéro, comme celui que le Log
+vérifie au démarrage. Chaque noyau supporté par le CPU est comparé au memcmp
+du buffer avec lui-même décalé d'un mot (l'ancienne vérification).
+
+./scan-bench [size in MiB] [repetitions]*/
+
+static bool memcmp_is_zero(uint8_t const* buf, size_t len) {
+  return buf[0] == 0 && memcmp(buf, buf + 1, len - 1) == 0;
+}
+
+template <typename F>
+static void run(char const* name, uint8_t const* buf, size_t len, int reps,
+                F is_zero) {
+  double best = 0;
+  for (int i = 0; i < reps; i++) {
+    auto start = std::chrono::steady_clock::now();
+    if (!is_zero(buf, len)) {
+      throw std::runtime_error("The buffer should be zeroed out");
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    auto gbs = static_cast<double>(len) / elapsed.count() / 1e9;
+    best = gbs > best ? gbs : best;
+  }
+
+  std::cout << name << ": " << best << " GB/s" << std::endl;
+}
+
+// Starts that are not aligned on any vector width and odd lengths: a zeroed
+// range is zero even when the bytes around it are not, a single stray byte in
+// it is found wherever it is
+static void check_edges(dory::scan::Kernel k, uint8_t* buf) {
+  size_t const lengths[] = {0,   1,    7,    8,    9,    18,   21,    127,
+                            129, 255,  257,  4095, 4097, 8191, 12377, 16411};
+
+  for (size_t off = 0; off < 64; off++) {
+    for (auto len : lengths) {
+      auto b = buf + 1 + off;
+      memset(b - 1, 0xff, len + 2);
+      memset(b, 0, len);
+
+      if (!dory::scan::isZero(k, b, len)) {
+        throw std::runtime_error(std::string(dory::scan::name(k)) +
+                                 ": zeroed range reported dirty");
+      }
+
+      for (auto pos : {size_t{0}, len / 2, len - 1}) {
+        if (len == 0) {
+          break;
+        }
+
+        b[pos] = 1;
+        if (dory::scan::isZero(k, b, len)) {
+          throw std::runtime_error(std::string(dory::scan::name(k)) +
+                                   ": missed a non-zero byte");
+        }
+        b[pos] = 0;
+      }
+    }
+  }
+}
+
+int main(int argc, char* argv[]) {
+  size_t size_mib = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2048;
+  int reps = argc > 2 ? atoi(argv[2]) : 5;
+  size_t len = size_mib * 1024 * 1024;
+  if (len == 0 || reps <= 0) {
+    throw std::runtime_error("Provide a size in MiB and a repetition count");
+  }
+
+  auto buf = reinterpret_cast<uint8_t*>(aligned_alloc(4096, len));
+  if (buf == nullptr) {
+    throw std::runtime_error("Could not allocate the buffer");
+  }
+  memset(buf, 0, len);
+
+  std::cout << "SCANNING " << size_mib << " MiB, BEST OF " << reps
+            << std::endl;
+
+  run("memcmp", buf, len, reps, memcmp_is_zero);
+
+  for (auto k : {dory::scan::Kernel::Scalar, dory::scan::Kernel::Avx2,
+                 dory::scan::Kernel::Avx512}) {
+    if (!dory::scan::supported(k)) {
+      std::cout << dory::scan::name(k) << ": not supported" << std::endl;
+      continue;
+    }
+
+    run(dory::scan::name(k), buf, len, reps,
+        [k](uint8_t const* b, size_t l) { return dory::scan::isZero(k, b, l); });
+  }
+
+  // Sized for the largest range at the last offset (ASan catches a read past
+  // it, the non-zero guard bytes catch the others)
+  auto edges = reinterpret_cast<uint8_t*>(malloc(64 + 16411 + 2));
+  for (auto k : {dory::scan::Kernel::Scalar, dory::scan::Kernel::Avx2,
+                 dory::scan::Kernel::Avx512}) {
+    if (dory::scan::supported(k)) {
+      check_edges(k, edges);
+    }
+  }
+  free(edges);
+  std::cout << "EDGE CASES: OK" << std::endl;
+
+  // A single stray byte at the end must still be found
+  buf[len - 1] = 1;
+  if (dory::scan::isZero(buf, len)) {
+    throw std::runtime_error("The selected kernel missed a non-zero byte");
+  }
+
+  std::cout << "SELECTED: " << dory::scan::name(dory::scan::best())
+            << std::endl;
+
+  free(buf);
+  return 0;
+}
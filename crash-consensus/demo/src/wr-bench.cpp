@@ -0,0 +1,74 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <dory/conn/wr-builder.hpp>
+#include <dory/conn/wr-template.hpp>
+
+/*Coût côté CPU de la préparation des RDMA writes du fast path : un WR
+reconstruit à chaque fois par SendWrBuilder (l'ancien postSendSingle), ou le
+WR pré-construit de WriteTemplate (postWrite).
+
+./wr-bench [iterations] [replicas]*/
+
+// Stands for ibv_post_send: the compiler must assume the whole WR is read
+static inline void post(void* wr) { asm volatile("" : : "r"(wr) : "memory"); }
+
+template <typename F>
+static double ns_per_wr(int iterations, F prepare) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    prepare(i);
+  }
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / iterations;
+}
+
+int main(int argc, char* argv[]) {
+  int iterations = argc > 1 ? atoi(argv[1]) : 10000000;
+  int replicas = argc > 2 ? atoi(argv[2]) : 2;
+  if (iterations <= 0 || replicas <= 0) {
+    std::cout << "Provide a positive number of iterations and replicas"
+              << std::endl;
+    return 1;
+  }
+
+  std::vector<uint8_t> buf(4096);
+  uintptr_t remote = 0x10000;
+
+  auto built = ns_per_wr(iterations, [&](int i) {
+    struct ibv_send_wr wr;
+    struct ibv_sge sg;
+    dory::SendWrBuilder()
+        .req(dory::ReliableConnection::RdmaWrite)
+        .signaled(true)
+        .req_id(static_cast<uint64_t>(i))
+        .buf(buf.data())
+        .len(512)
+        .lkey(1)
+        .remote_addr(remote + static_cast<uintptr_t>(i % 64) * 64)
+        .rkey(2)
+        .build(wr, sg);
+    post(&wr);
+  });
+
+  dory::WriteTemplate tmpl;
+  tmpl.setKeys(1, 2);
+  tmpl.setInlineLimit(dory::ReliableConnection::MaxInlining);
+
+  auto cached = ns_per_wr(iterations, [&](int i) {
+    post(&tmpl.fill(static_cast<uint64_t>(i), buf.data(), 512,
+                    remote + static_cast<uintptr_t>(i % 64) * 64, true));
+  });
+
+  std::cout << "SendWrBuilder: " << built << " ns/WR" << std::endl;
+  std::cout << "WriteTemplate: " << cached << " ns/WR" << std::endl;
+  std::cout << "Saved per propose (" << replicas
+            << " replicas): " << (built - cached) * replicas << " ns"
+            << std::endl;
+
+  return 0;
+}
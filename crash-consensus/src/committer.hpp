@@ -0,0 +1,152 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "config.hpp"
+#include "pinning.hpp"
+#include "readerwriterqueue.h"
+
+namespace dory {
+/*Délivre les commandes commitées à l'application. Les boucles de commit
+ajoutent chaque commande avec append(), puis flush() les donne toutes d'un coup
+au handler (tout ce qui se trouve entre l'ancien et le nouveau FUO).
+Le handler par entrée historique n'est qu'un adaptateur au-dessus.
+
+Un seul Committer est partagé par le leader (propose) et le follower : ils ne
+commitent jamais en même temps, puisqu'ils possèdent le log à tour de rôle.
+
+En mode applyInBackground, flush() ne fait que publier les commandes dans une
+file lock-free, et un thread dédié appelle le handler dans l'ordre. Le chemin de
+réplication n'attend donc plus l'application.*/
+class Committer {
+ public:
+  using Record = std::pair<uint8_t *, size_t>;
+  using BatchHandler =
+      std::function<void(bool leader, Record const *records, size_t num)>;
+
+  void batchHandler(BatchHandler f) { handler = std::move(f); }
+
+  void entryHandler(std::function<void(bool, uint8_t *, size_t)> f) {
+    handler = [f](bool leader, Record const *records, size_t num) {
+      for (size_t i = 0; i < num; i++) {
+        f(leader, records[i].first, records[i].second);
+      }
+    };
+  }
+
+  void applyInBackground(ConsensusConfig::ThreadConfig const &threadConfig) {
+    if (background) {
+      throw std::runtime_error("The apply thread is already running");
+    }
+
+    background = true;
+    apply_thd = std::thread([this]() { apply(); });
+
+    if (threadConfig.pinThreads) {
+      pinThreadToCore(apply_thd, threadConfig.applyThreadCoreID);
+    }
+
+    if (ConsensusConfig::nameThreads) {
+      setThreadName(apply_thd, ConsensusConfig::applyThreadName);
+    }
+  }
+
+  inline void append(uint8_t *buf, size_t len) {
+    records.emplace_back(buf, len);
+  }
+
+  inline void flush(bool leader) {
+    if (records.empty()) {
+      return;
+    }
+
+    auto num = records.size();
+
+    if (background) {
+      for (auto const &r : records) {
+        queue.enqueue(Item{leader, r});
+      }
+      committed.fetch_add(num, std::memory_order_release);
+    } else {
+      handler(leader, records.data(), num);
+      committed.fetch_add(num, std::memory_order_release);
+      applied.fetch_add(num, std::memory_order_release);
+    }
+
+    records.clear();
+  }
+
+  // Number of commands committed / handed to the application so far
+  inline uint64_t committedIndex() const {
+    return committed.load(std::memory_order_acquire);
+  }
+
+  inline uint64_t appliedIndex() const {
+    return applied.load(std::memory_order_acquire);
+  }
+
+  void waitApplied(uint64_t index) const {
+    while (appliedIndex() < index) {
+      ;
+    }
+  }
+
+  // The records point inside the log, they must be applied before the log is
+  // recycled
+  inline void drain() const { waitApplied(committedIndex()); }
+
+ private:
+  static constexpr size_t MaxApplyBatch = 4096;
+
+  struct Item {
+    bool leader;
+    Record record;
+  };
+
+  void apply() {
+    std::vector<Record> batch;
+    bool batch_leader = false;
+    Item item;
+
+    auto deliver = [&]() {
+      if (batch.empty()) {
+        return;
+      }
+
+      handler(batch_leader, batch.data(), batch.size());
+      applied.fetch_add(batch.size(), std::memory_order_release);
+      batch.clear();
+    };
+
+    while (true) {
+      while (batch.size() < MaxApplyBatch && queue.try_dequeue(item)) {
+        if (!batch.empty() && item.leader != batch_leader) {
+          deliver();
+        }
+
+        batch_leader = item.leader;
+        batch.push_back(item.record);
+      }
+
+      deliver();
+    }
+  }
+
+  BatchHandler handler;
+  std::vector<Record> records;
+
+  bool background = false;
+  std::thread apply_thd;
+  moodycamel::ReaderWriterQueue<Item> queue{4096};
+
+  alignas(64) std::atomic<uint64_t> committed{0};
+  alignas(64) std::atomic<uint64_t> applied{0};
+};
+}  // namespace dory
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
 namespace dory {
 namespace ConsensusConfig {
 
@@ -10,9 +14,133 @@ static const char switcherThreadName[] = "thd_switcher";
 static const char heartbeatThreadName[] = "thd_heartbeat";
 static const char followerThreadName[] = "thd_follower";
 static const char fileWatcherThreadName[] = "thd_filewatcher";
+static const char applyThreadName[] = "thd_apply";
+static const char reclaimThreadName[] = "thd_reclaim";
+static const char flushThreadName[] = "thd_flush";
+
+// Number of submissions that can wait for the handover thread at once
+// (power of 2)
+static constexpr size_t submissionRingSize = 1024;
+
+// Group commit of the submissions: while replication is busy, the leader
+// waits up to groupCommitWindowNs for more commands and packs them in a single
+// log entry, up to groupCommitMaxBytes / groupCommitMaxCommands. An idle
+// pipeline is flushed right away.
+static constexpr uint64_t groupCommitWindowNs = 2000;
+static constexpr size_t groupCommitMaxBytes = 16 * 1024;
+static constexpr size_t groupCommitMaxCommands = 256;
+
+// Selective signaling of the replication writes: only one write out of
+// writeSignalInterval asks for a completion on each QP, the others are
+// acknowledged by the next signaled one (RC completes them in order). The
+// interval is capped at outstanding_req + 1, so the leader never waits for a
+// write that has no completion. 1 signals every write.
+static constexpr int writeSignalInterval = 8;
+
+// Read lease of the leader: a write acknowledged by a majority proves that
+// nobody else can commit before leaderLeaseNs have elapsed since it was posted,
+// because the followers wait that long between revoking the permissions of a
+// leader and granting them to the next one. 0 disables the local reads.
+// Assumes the clocks of the replicas drift by much less than the lease.
+static constexpr uint64_t leaderLeaseNs = 2000000;
+
+// Registered memory of the replication plane: the scratchpad and the log
+// share a single buffer of logSize bytes, optionally backed by huge pages
+// (regular pages are used if the system has none to spare).
+static constexpr size_t defaultLogSize = 2UL * 1024 * 1024 * 1024;
+
+enum class HugePages { None, Huge2MiB, Huge1GiB };
+
+// The reclaimed parts of the log are zeroed in the background, reclaimChunk
+// bytes at a time (see LogReclaimer)
+static constexpr size_t reclaimChunk = 256 * 1024;
+
+// The leader enters a new ring segment only once every replica answered its
+// recycling request (see LogRecycling). A replica that stays silent for
+// recyclingReplyTimeoutMs makes the proposal fail (RecyclingUnanswered)
+// instead of stalling the leader. Until it replies, the next proposals that
+// reach a segment boundary fail right away, without waiting again.
+static constexpr uint64_t recyclingReplyTimeoutMs = 1000;
+
+// Durable log (MemoryConfig::logPath): the registered memory is a shared
+// mapping of a file, or of a DAX device, that survives the process. The log
+// is written back to it:
+//  - PerEntry: every entry as soon as it is in the local log, before it
+//    commits (what the replica accepted is durable)
+//  - PerBatch: once per commit round, everything up to the new FUO (a group
+//    commit or a proposeBatch costs a single flush)
+//  - Async: by a background thread, every asyncFlushIntervalUs at most, the
+//    replication path never waits for the device
+// With PerEntry and PerBatch, the leader reports a proposal as committed only
+// once a majority of the replicas flushed it (see DurableQuorum), and fails it
+// (FlushUnconfirmed) if that takes more than flushConfirmTimeoutMs. With Async
+// a committed command may still be only in the page cache or the CPU caches.
+enum class FlushPolicy { None, PerEntry, PerBatch, Async };
+static constexpr uint64_t asyncFlushIntervalUs = 100;
+static constexpr uint64_t flushConfirmTimeoutMs = 1000;
+
+// A replica reads the snapshot of another one (see SnapshotStore) in
+// snapshotReadChunk-byte RDMA reads, up to snapshotReadWindow of them in
+// flight, and gives up after snapshotFetchAttempts torn copies
+static constexpr size_t snapshotReadChunk = 1024 * 1024;
+static constexpr size_t snapshotReadWindow = 16;
+static constexpr int snapshotFetchAttempts = 8;
+
+// The log is exported (see LogStream) exportChunk bytes at a time, the
+// replica cannot replicate while a chunk is written out
+static constexpr size_t exportChunk = 4 * 1024 * 1024;
+
+struct MemoryConfig {
+  MemoryConfig()
+      : logSize{defaultLogSize},
+        hugePages{HugePages::None},
+        snapshotSize{0},
+        flushPolicy{FlushPolicy::PerBatch},
+        indexLog{true},
+        populateThreads{8},
+        sendQueueDepth{0},
+        completionQueueDepth{0} {}
+
+  size_t logSize;
+  HugePages hugePages;
+
+  // Part of logSize set aside for the snapshot of the application, 0 disables
+  // snapshots. Must be the same on every replica.
+  size_t snapshotSize;
+
+  // Empty for a volatile log. Otherwise the file is created with logSize
+  // bytes if needed, and a process that restarts on it resumes from the FUO
+  // of the log header it finds there (huge pages do not apply). A DAX file
+  // is flushed with cache line write-backs. Any other file goes through
+  // msync, and the flusher first has to dirty every page from the CPU
+  // because the NIC writes do not mark them dirty. That costs a page fault
+  // per page and per flush.
+  std::string logPath;
+  FlushPolicy flushPolicy;
+
+  // Index of the entries of the current lap (4 bytes per entry, see
+  // LogIndex): a new leader finds its tail without scanning the entries it
+  // already saw, and entries can be looked up by sequence number
+  bool indexLog;
+
+  // Threads that fault in the pages of a volatile log before it is
+  // registered, 0 leaves it to the registration (single threaded)
+  int populateThreads;
+
+  // Depth of the send queue of each replication QP, and of the CQ they share.
+  // 0 sizes them after outstanding_req (twice the window, so that a replica
+  // outside the quorum can lag behind), within the limits of the device. The
+  // CQ must hold a completion for every WR of every send queue. A replica
+  // whose send queue is full throttles the leader instead of failing it.
+  int sendQueueDepth;
+  int completionQueueDepth;
+};
 
 static constexpr int handoverThreadBankAB_ID = 0; //sibling 1
 static constexpr int fileWatcherThreadBankAB_ID = 10; //sibling 3
+static constexpr int applyThreadBankAB_ID = 11;
+static constexpr int reclaimThreadBankAB_ID = 12;
+static constexpr int flushThreadBankAB_ID = 13;
 
 static constexpr int consensusThreadBankA_ID = 15; //sibling 1 
 static constexpr int consensusThreadBankB_ID = -1;
@@ -36,6 +164,9 @@ struct ThreadConfig {
         heartbeatThreadCoreID{heartbeatThreadBankA_ID},
         followerThreadCoreID{followerThreadBankA_ID},
         fileWatcherThreadCoreID{fileWatcherThreadBankAB_ID},
+        applyThreadCoreID{applyThreadBankAB_ID},
+        reclaimThreadCoreID{reclaimThreadBankAB_ID},
+        flushThreadCoreID{flushThreadBankAB_ID},
         prefix{""} {}
 
   bool pinThreads;
@@ -51,6 +182,9 @@ struct ThreadConfig {
   int heartbeatThreadCoreID;
   int followerThreadCoreID;
   int fileWatcherThreadCoreID;
+  int applyThreadCoreID;
+  int reclaimThreadCoreID;
+  int flushThreadCoreID;
   std::string prefix;
 };
 
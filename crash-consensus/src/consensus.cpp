@@ -1,5 +1,7 @@
 #include "consensus.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 // #include <algorithm>
 // #include <functional>
@@ -8,7 +10,8 @@ namespace dory {
 RdmaConsensus::RdmaConsensus(int my_id, std::vector<int>& remote_ids,
                              int outstanding_req,
                              bool want_tofino,
-                             ConsensusConfig::ThreadConfig threadConfig)
+                             ConsensusConfig::ThreadConfig threadConfig,
+                             ConsensusConfig::MemoryConfig memoryConfig)
     : my_id{my_id},
       remote_ids{remote_ids},
       am_I_leader{false},
@@ -18,10 +21,16 @@ RdmaConsensus::RdmaConsensus(int my_id, std::vector<int>& remote_ids,
       store(threadConfig.prefix),
       LOGGER_INIT(logger, ConsensusConfig::logger_prefix),
       use_tofino(want_tofino) {
-  using namespace units;
-
-  allocated_size = 2_GiB;
+  allocated_size = memoryConfig.logSize;
   alignment = 64;
+  huge_pages = memoryConfig.hugePages;
+  snapshot_size = memoryConfig.snapshotSize;
+  log_path = memoryConfig.logPath;
+  flush_policy = memoryConfig.flushPolicy;
+  index_log = memoryConfig.indexLog;
+  populate_threads = memoryConfig.populateThreads;
+  send_queue_depth = memoryConfig.sendQueueDepth;
+  cq_depth = memoryConfig.completionQueueDepth;
 
   run();
 
@@ -31,8 +40,14 @@ RdmaConsensus::RdmaConsensus(int my_id, std::vector<int>& remote_ids,
   commit_iter = re_ctx->log.liveIterator();
 
   follower = Follower(re_ctx.get(), leader_election->context(), &iter,
-                      &commit_iter, threadConfig);
+                      &commit_iter, &committer, &progress, reclaimer.get(),
+                      flusher.get(), threadConfig);
+  leader_election->context()->poller.registerContext(quorum::FlushMarkRd);
   follower.waitForPoller();
+
+  durable = DurableQuorum(
+      leader_election->context(),
+      static_cast<int>(quorum::majority(remote_ids.size() + 1)) - 1);
 }
 
 RdmaConsensus::~RdmaConsensus() { consensus_thd.join(); }
@@ -83,6 +98,42 @@ void RdmaConsensus::spawn_follower() {
   }
 }
 
+// Depths of the replication queues (see MemoryConfig::sendQueueDepth), the
+// ones asked explicitly are checked against the device when created
+void RdmaConsensus::size_queues() {
+  auto replicas = std::max(static_cast<int>(remote_ids.size()), 1);
+
+  if (send_queue_depth == 0) {
+    send_queue_depth =
+        std::max(ReliableConnection::WRDepth, 2 * (outstanding_req + 1));
+    send_queue_depth = std::min(
+        {send_queue_depth, cb->maxQPDepth(), cb->maxCQDepth() / replicas});
+  }
+
+  if (cq_depth == 0) {
+    cq_depth = std::min(
+        std::max(ControlBlock::CQDepth, replicas * send_queue_depth),
+        cb->maxCQDepth());
+  }
+
+  if (cq_depth < replicas * send_queue_depth) {
+    throw std::runtime_error(
+        "A replication CQ of " + std::to_string(cq_depth) +
+        " completions could overflow with " + std::to_string(replicas) +
+        " send queues of " + std::to_string(send_queue_depth) + " WRs");
+  }
+
+  if (send_queue_depth <= outstanding_req) {
+    LOGGER_WARN(logger,
+                "{} WRs per send queue for {} outstanding requests: the "
+                "slowest replica paces the leader",
+                send_queue_depth, outstanding_req);
+  }
+
+  LOGGER_INFO(logger, "Replication queues: {} WRs per QP, CQ of {}",
+              send_queue_depth, cq_depth);
+}
+
 
 /*C'est là que tout s'initialise : connexions, contextes etc. */
 void RdmaConsensus::run() {
@@ -116,17 +167,38 @@ void RdmaConsensus::run() {
   // Configure the control block
   cb = std::make_unique<ControlBlock>(*rp.get());
   cb->registerPD("primary");
-  cb->allocateBuffer("shared-buf", allocated_size, alignment);
-  cb->registerMR("shared-mr", "primary", "shared-buf",
-                 ControlBlock::LOCAL_READ | ControlBlock::LOCAL_WRITE |
-                     ControlBlock::REMOTE_READ | ControlBlock::REMOTE_WRITE);
-  cb->registerCQ("cq-replication");
+  auto pages = ControlBlock::RegularPages;
+  if (huge_pages == ConsensusConfig::HugePages::Huge2MiB) {
+    pages = ControlBlock::HugePages2MiB;
+  } else if (huge_pages == ConsensusConfig::HugePages::Huge1GiB) {
+    pages = ControlBlock::HugePages1GiB;
+  }
+
+  auto alloc_start = std::chrono::steady_clock::now();
+  if (log_path.empty()) {
+    cb->allocateBuffer("shared-buf", allocated_size, alignment, pages,
+                       populate_threads);
+    cb->registerMR("shared-mr", "primary", "shared-buf",
+                   ControlBlock::LOCAL_READ | ControlBlock::LOCAL_WRITE |
+                       ControlBlock::REMOTE_READ | ControlBlock::REMOTE_WRITE);
+  } else {
+    // Durable log: the whole registered memory lives in the file
+    log_file = std::make_unique<MappedFile>(log_path, allocated_size);
+    LOGGER_INFO(logger, "Log backed by {} ({})", log_path,
+                log_file->dax() ? "DAX" : "page cache, msync");
+    cb->registerExternalMR(
+        "shared-mr", "primary", log_file->data(), allocated_size,
+        ControlBlock::LOCAL_READ | ControlBlock::LOCAL_WRITE |
+            ControlBlock::REMOTE_READ | ControlBlock::REMOTE_WRITE);
+  }
+  size_queues();
+  cb->registerCQ("cq-replication", cq_depth);
   cb->registerCQ("cq-leader-election");
 
   // Configure the connection exchanger for the replication plane
   ce_replication = std::make_unique<ConnectionExchanger>(my_id, remote_ids, *cb.get());
   ce_replication->configure_all("primary", "shared-mr", "cq-replication",
-                                "cq-replication");
+                                "cq-replication", send_queue_depth);
   
   // Configure the connection exchanger for background plane
   ce_leader_election = std::make_unique<ConnectionExchanger>(my_id, remote_ids, *cb.get()); //utiliser make_unique avec ipAddresses dans ConnectionExchanger produit des erreurs de mémoire
@@ -144,15 +216,63 @@ void RdmaConsensus::run() {
   auto shared_memory_addr = reinterpret_cast<uint8_t*>(cb->mr("shared-mr").addr);
   overlay = std::make_unique<OverlayAllocator>(shared_memory_addr, allocated_size);
   scratchpad =  std::make_unique<ScratchpadMemory>(ids, *overlay.get(), alignment);
+
+  // The snapshot area comes before the log, at the same offset everywhere
+  if (snapshot_size > 0) {
+    auto [snapmem_ok, snapmem] = overlay->allocate(snapshot_size, alignment);
+    if (!snapmem_ok) {
+      throw std::runtime_error("The snapshot area (" +
+                               std::to_string(snapshot_size) +
+                               " bytes) does not fit in the log size");
+    }
+
+    snapshots = SnapshotStore(snapmem, snapshot_size,
+                              snapmem - shared_memory_addr,
+                              log_file != nullptr);
+  }
+
   auto [logmem_ok, logmem, logmem_size] = overlay->allocateRemaining(alignment);
 
   LOGGER_INFO(logger, "Log allocation... {}", logmem_ok ? "OK" : "FAILED");
+  if (!logmem_ok || logmem_size < LogConfig::RingSegments * 2 *
+                                      constants::CRITICAL_LOG_FREE_SPACE) {
+    throw std::runtime_error(
+        "The log size leaves no room for the log after the scratchpad (" +
+        std::to_string(allocated_size) + " bytes)");
+  }
+
   LOGGER_INFO(logger, "Log (address: 0x{:x}, size: {} bytes)",
               uintptr_t(logmem), logmem_size);
 
   auto log_offset = logmem - shared_memory_addr;
 
-  replication_log = std::make_unique<Log>(logmem, logmem_size);
+  // The buffer of a volatile log is a fresh anonymous mapping, no need to
+  // check that it is zeroed
+  replication_log = std::make_unique<Log>(
+      logmem, logmem_size, log_file != nullptr, log_file == nullptr);
+  if (index_log) {
+    replication_log->enableIndex();
+  }
+
+  LOGGER_INFO(logger, "Log memory ready in {} ms",
+              std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::steady_clock::now() - alloc_start)
+                  .count());
+
+  if (replication_log->resumed()) {
+    LOGGER_INFO(logger, "Resuming the log from FUO {}",
+                replication_log->headerFirstUndecidedOffset());
+  }
+
+  reclaimer = std::make_unique<LogReclaimer>(*replication_log);
+  reclaimer->spawn(threadConfig);
+
+  flusher = std::make_unique<LogFlusher>(
+      *replication_log,
+      log_file ? flush_policy : ConsensusConfig::FlushPolicy::None,
+      log_file && log_file->dax());
+  flusher->publishTo(scratchpad->flushMarkSlot());
+  flusher->spawn(threadConfig);
 
   std::cout << "connecting all" << std::endl;  
   //connecting everything 
@@ -207,7 +327,7 @@ void RdmaConsensus::run() {
   lsr = std::make_unique<LogSlotReader>(re_ctx.get(), *scratchpad.get(),
                                         next_log_entry_offset);
 
-  follower.attach(&lsr, scratchpad.get());
+  follower.attach(&lsr, scratchpad.get(), &snapshots);
 
   log_recycling =  std::make_unique<LogRecycling>(re_ctx.get(), *scratchpad.get());
 
@@ -215,11 +335,18 @@ void RdmaConsensus::run() {
   majW = std::make_unique<FixedSizeMajorityOperation<SequentialQuorumWaiter,
                                                      WriteLogMajorityError>>(
       &re_ctx->cc, *sqw.get(), re_ctx->cc.remote_ids);
+  majW->signalEvery(ConsensusConfig::writeSignalInterval);
+
+  send_regions.push_back(cb->mr("shared-mr"));
 
   to_remote_memory.resize(Identifiers::maxID(remote_ids) + 1);
   std::fill(to_remote_memory.begin(), to_remote_memory.end(), log_offset);
   dest = to_remote_memory;
 
+  to_remote_lease.resize(to_remote_memory.size());
+  std::fill(to_remote_lease.begin(), to_remote_lease.end(),
+            scratchpad->leaderLeaseSlotOffset());
+
   LOGGER_INFO(logger, "Waiting (5 sec) for all threads to start");
   std::this_thread::sleep_for(std::chrono::seconds(5));
 
@@ -231,10 +358,802 @@ void RdmaConsensus::run() {
 }
 
 int RdmaConsensus::propose(uint8_t* buf, size_t buf_len) {
+  return await_durable(propose_impl(buf, buf_len));
+}
+
+int RdmaConsensus::propose(struct iovec const* iov, int iovcnt) {
+  Log::GatherPayload payload{iov, iovcnt};
+
+  auto entry_size = LogConfig::entrySize(payload.size());
+  if (entry_size > constants::MAX_ENTRY_SIZE) {
+    throw std::runtime_error("Command does not fit in a single log entry");
+  }
+
+  return await_durable(propose_impl(payload));
+}
+
+void RdmaConsensus::registerMemory(void* addr, size_t len) {
+  auto name = "app-mr-" + std::to_string(send_regions.size());
+  cb->registerExternalMR(name, "primary", addr, len, ControlBlock::LOCAL_READ);
+  send_regions.push_back(cb->mr(name));
+}
+
+bool RdmaConsensus::lkey_of(void* addr, size_t len, uint32_t& lkey) {
+  auto start = reinterpret_cast<uintptr_t>(addr);
+  for (auto const& r : send_regions) {
+    if (r.addr <= start && start + len <= r.addr + r.size) {
+      lkey = r.lkey;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+std::tuple<bool, ptrdiff_t, size_t> RdmaConsensus::fast_write(
+    uint64_t local_fuo, std::atomic<Leader>& leader,
+    Log::GatherPayload const& payload) {
+  // Header and canary come from the log, so at most SGEDepth - 2 buffers
+  bool can_gather = !use_tofino &&
+                    payload.iovcnt <= ReliableConnection::SGEDepth - 2;
+
+  // An inline write copies the application buffers when it is posted, they
+  // need not be registered then
+  bool inlined = LogConfig::SlotHeaderSize + payload.size() + 1 <=
+                 majW->inlineLimit();
+
+  gather_sges.resize(payload.iovcnt + 2);
+  for (int i = 0; can_gather && i < payload.iovcnt; i++) {
+    auto& sge = gather_sges[i + 1];
+    sge.addr = reinterpret_cast<uintptr_t>(payload.iov[i].iov_base);
+    sge.length = static_cast<uint32_t>(payload.iov[i].iov_len);
+    can_gather = lkey_of(payload.iov[i].iov_base, payload.iov[i].iov_len,
+                         sge.lkey) ||
+                 inlined;
+  }
+
+  if (!can_gather) {
+    Slot slot(re_ctx->log, proposal_nr, local_fuo, payload);
+    auto [address, offset, size] = slot.location();
+
+    auto ok = majW->fastWrite(address, size, to_remote_memory, offset, leader,
+                              outstanding_req, use_tofino);
+    return std::make_tuple(ok, offset, size);
+  }
+
+  // Only the header and the canary are written locally before posting, the
+  // body is copied while the NIC gathers it from the application buffers
+  auto body = re_ctx->log.nextEntryPtr() + LogConfig::SlotHeaderSize;
+  auto body_len = payload.size();
+  Slot slot(re_ctx->log, proposal_nr, local_fuo,
+            Log::InPlacePayload{body, body_len});
+  auto [address, offset, size] = slot.location();
+
+  auto lkey = send_regions.front().lkey;
+  gather_sges.front() = {reinterpret_cast<uintptr_t>(address),
+                         LogConfig::SlotHeaderSize, lkey};
+  gather_sges.back() = {reinterpret_cast<uintptr_t>(body + body_len), 1, lkey};
+
+  auto ok = majW->fastWriteGather(
+      gather_sges, to_remote_memory, offset, leader, outstanding_req,
+      [body, &payload]() {
+        auto dst = body;
+        for (int i = 0; i < payload.iovcnt; i++) {
+          memcpy(dst, payload.iov[i].iov_base, payload.iov[i].iov_len);
+          dst += payload.iov[i].iov_len;
+        }
+      });
+
+  // The quorum (and outstanding_req) lets propose return while the other
+  // writes still read the application buffers, which the caller may reuse
+  // right after
+  if (ok && !inlined) {
+    ok = majW->waitAllAcknowledged(leader, outstanding_req);
+  }
+
+  return std::make_tuple(ok, offset, size);
+}
+
+int RdmaConsensus::proposeBatch(
+    std::vector<std::pair<uint8_t*, size_t>>& cmds) {
+  if (cmds.empty()) {
+    return ret_no_error();
+  }
+
+  // The entry is read back into MAX_ENTRY_SIZE scratchpad slots during
+  // catch-up, so the whole batch has to fit in one of them.
+  auto entry_size =
+      LogConfig::entrySize(ParsedSlot::batchPayloadSize(cmds));
+  if (entry_size > constants::MAX_ENTRY_SIZE) {
+    throw std::runtime_error("Batch does not fit in a single log entry");
+  }
+
+  return await_durable(propose_impl(cmds));
+}
+
+void RdmaConsensus::spawnHandover() {
+  handover_thd = std::thread([this]() { serve_submissions(); });
+
+  if (threadConfig.pinThreads) {
+    pinThreadToCore(handover_thd, threadConfig.handoverThreadCoreID);
+  }
+
+  if (ConsensusConfig::nameThreads) {
+    setThreadName(handover_thd, ConsensusConfig::handoverThreadName);
+  }
+}
+
+bool RdmaConsensus::replication_idle() {
+  std::unique_lock<std::mutex> lock(follower.lock(), std::defer_lock);
+
+  // In follower mode there is nothing to wait for, the proposal fails anyway
+  if (!lock.try_lock()) {
+    return true;
+  }
+
+  if (!poll_fast_writes(lock)) {
+    return true;
+  }
+
+  return majW->outstandingWrites() == 0;
+}
+
+void RdmaConsensus::serve_submissions() {
+  using Clock = std::chrono::steady_clock;
+  auto const window =
+      std::chrono::nanoseconds(ConsensusConfig::groupCommitWindowNs);
+  auto const max_cmds = std::min(ConsensusConfig::groupCommitMaxCommands,
+                                 ConsensusConfig::submissionRingSize);
+  auto const max_bytes = ConsensusConfig::groupCommitMaxBytes;
+
+  static_assert(LogConfig::entrySize(ConsensusConfig::groupCommitMaxBytes) <=
+                    constants::MAX_ENTRY_SIZE,
+                "A group commit must fit in a single log entry");
+
+  while (true) {
+    if (submissions.ready(1) == 0) {
+      continue;
+    }
+
+    size_t taken = 0;
+    size_t bytes = 0;
+    bool full = false;
+
+    // Takes the newly arrived commands, returns whether the batch is full
+    auto take = [&]() {
+      auto avail = submissions.ready(max_cmds);
+      for (; taken < avail; taken++) {
+        auto len = submissions.peek(taken).second +
+                   sizeof(ParsedSlot::BatchRecordLength);
+        if (taken > 0 && bytes + len > max_bytes) {
+          return true;
+        }
+        bytes += len;
+      }
+
+      return taken == max_cmds || bytes >= max_bytes;
+    };
+
+    full = take();
+
+    // While the previous entries are still on the wire, we can afford to wait
+    // a bit for more commands
+    auto start = Clock::now();
+    while (!full && window.count() > 0 && !replication_idle() &&
+           Clock::now() - start < window) {
+      full = take();
+    }
+
+    int ret;
+    if (taken == 1) {
+      auto [buf, len] = submissions.peek(0);
+      ret = propose(buf, len);
+    } else {
+      gc_cmds.clear();
+      for (size_t i = 0; i < taken; i++) {
+        gc_cmds.push_back(submissions.peek(i));
+      }
+      ret = proposeBatch(gc_cmds);
+    }
+
+    submissions.complete(taken, ret);
+
+    gc_entries.fetch_add(1, std::memory_order_relaxed);
+    gc_commands.fetch_add(taken, std::memory_order_relaxed);
+    if (taken > gc_max_batch.load(std::memory_order_relaxed)) {
+      gc_max_batch.store(taken, std::memory_order_relaxed);
+    }
+  }
+}
+
+int RdmaConsensus::proposeAsync(uint8_t* buf, size_t buf_len,
+                                uint64_t& ticket) {
+  auto ret = propose_impl(buf, buf_len);
+
+  // Adopting the value of a previous leader succeeds without writing ours,
+  // so we propose again until the payload itself is in the log
+  while (ret == ret_no_error() && payload_req_id == 0) {
+    ret = propose_impl(buf, buf_len);
+  }
+
+  if (ret != ret_no_error()) {
+    return ret;
+  }
+
+  ticket = ++last_ticket;
+  pending_tickets.push_back(
+      std::make_tuple(ticket, payload_req_id, written_up_to));
+  return ret;
+}
+
+int RdmaConsensus::poll() {
+  std::unique_lock<std::mutex> lock(follower.lock(), std::defer_lock);
+
+  if (pending_tickets.empty()) {
+    return 0;
+  }
+
+  if (!lock.try_lock()) {
+    // The follower owns the log, I am not the leader anymore
+    failed_up_to = last_ticket;
+  } else if (failed_up_to < std::get<0>(pending_tickets.back())) {
+    if (poll_fast_writes(lock)) {
+      renew_lease();
+    }
+  }
+
+  if (lock.owns_lock()) {
+    lock.unlock();
+  }
+
+  auto replicated = majW->latestReplicatedID();
+  int resolved = 0;
+
+  while (!pending_tickets.empty()) {
+    auto [ticket, req_id, end] = pending_tickets.front();
+    bool committed;
+
+    if (ticket <= failed_up_to) {
+      committed = false;
+      if (failed_tickets.empty() || failed_tickets.back().second + 1 != ticket) {
+        failed_tickets.push_back(std::make_pair(ticket, ticket));
+      } else {
+        failed_tickets.back().second = ticket;
+      }
+    } else if (req_id < replicated &&
+               (!flusher->majorityDurable() ||
+                durable.covered(proposal_nr, end))) {
+      committed = true;
+    } else {
+      break;
+    }
+
+    pending_tickets.pop_front();
+    resolved++;
+
+    if (completion) {
+      completion(ticket, committed);
+    }
+  }
+
+  return resolved;
+}
+
+bool RdmaConsensus::poll_fast_writes(std::unique_lock<std::mutex>& lock) {
+  if (!majW->pollFastWrites(outstanding_req, use_tofino)) {
+    LOGGER_TRACE(logger,
+                 "Error in fast-path: occurred when polling the "
+                 "outstanding writes");
+    auto err = majW->fastWriteError();
+    majW->recoverFromError(err);
+    ret_error(lock, ProposeError::FastPath, true);
+    return false;
+  }
+
+  acked_up_to.store(majW->latestReplicatedID());
+  return true;
+}
+
+bool RdmaConsensus::canServeLocalRead() {
+  if (!am_I_leader.load() || response_blocked->load()) {
+    return false;
+  }
+
+  // Somebody asked for the permissions, they will be revoked soon
+  if (leader_election->leaderSignal().load().requester != my_id) {
+    return false;
+  }
+
+  // Applied commands that a majority may not have yet could still be lost
+  if (applied_up_to.load() > acked_up_to.load()) {
+    return false;
+  }
+
+  return LeaseClock::now().time_since_epoch().count() < lease_expiry.load();
+}
+
+int RdmaConsensus::readBarrier() {
+  if (canServeLocalRead()) {
+    return ret_no_error();
+  }
+
+  std::unique_lock<std::mutex> lock(follower.lock(), std::defer_lock);
+
+  if (!lock.try_lock()) {
+    auto& leader = leader_election->leaderSignal();
+    potential_leader = leader.load().requester;
+    return static_cast<int>(ProposeError::MutexUnavailable);
+  }
+
+  if (!am_I_leader.load()) {
+    auto& leader = leader_election->leaderSignal();
+    potential_leader = leader.load().requester;
+    return static_cast<int>(ProposeError::FollowerMode);
+  }
+
+  // Until the slow-path ran, the local log may miss entries committed by the
+  // previous leader: a propose is needed first
+  if (ConsensusConfig::leaderLeaseNs == 0 || !fast_path || use_tofino) {
+    return static_cast<int>(ProposeError::LeaseUnavailable);
+  }
+
+  // Same as with_log, the commands of the outstanding writes are applied
+  // already
+  do {
+    if (!poll_fast_writes(lock)) {
+      return static_cast<int>(ProposeError::FastPath);
+    }
+  } while (majW->outstandingWrites() > 0);
+
+  renew_lease();
+  if (canServeLocalRead()) {
+    return ret_no_error();
+  }
+
+  // Any write to a majority proves we still hold the permissions, we bump a
+  // counter that nobody reads
+  auto& leader = leader_election->leaderSignal();
+  auto* counter = reinterpret_cast<uint64_t*>(scratchpad->leaderLeaseSlot());
+  *counter += 1;
+
+  auto posted_at = LeaseClock::now();
+  auto ok = majW->fastWrite(counter, sizeof(uint64_t), to_remote_lease, 0,
+                            leader, 0, false);
+  if (!ok) {
+    LOGGER_TRACE(logger,
+                 "Error in read barrier: occurred when writing the lease "
+                 "to a majority");
+    auto err = majW->fastWriteError();
+    majW->recoverFromError(err);
+
+    return ret_error(lock, ProposeError::FastPath, true);
+  }
+
+  extend_lease(posted_at);
+  return canServeLocalRead() ? ret_no_error()
+                             : static_cast<int>(ProposeError::LeaseUnavailable);
+}
+
+bool RdmaConsensus::canServeStaleRead(uint64_t max_lag_entries,
+                                      uint64_t max_lag_us) {
+  if (canServeLocalRead()) {
+    return true;
+  }
+
+  auto s = progress.snapshot();
+  return s.pending_entries <= max_lag_entries &&
+         s.staleness_ns <= max_lag_us * 1000;
+}
+
+bool RdmaConsensus::wait(uint64_t ticket) {
+  if (ticket == 0 || ticket > last_ticket) {
+    throw std::runtime_error("Unknown ticket");
+  }
+
+  while (!pending_tickets.empty() &&
+         std::get<0>(pending_tickets.front()) <= ticket) {
+    poll();
+  }
+
+  return std::none_of(failed_tickets.begin(), failed_tickets.end(),
+                      [ticket](std::pair<uint64_t, uint64_t> const& r) {
+                        return r.first <= ticket && ticket <= r.second;
+                      });
+}
+
+int RdmaConsensus::reserve(size_t len, Reservation& r) {
+  auto entry_size = LogConfig::entrySize(len);
+  if (entry_size > constants::MAX_ENTRY_SIZE) {
+    throw std::runtime_error("Reservation does not fit in a single log entry");
+  }
+
+  if (!am_I_leader.load()) {
+    auto& leader = leader_election->leaderSignal();
+    potential_leader = leader.load().requester;
+    return static_cast<int>(ProposeError::FollowerMode);
+  }
+
+  // The header of the entry (length, proposal, FUO) goes in front of the
+  // payload
+  reserved_entry = re_ctx->log.nextEntryPtr();
+  reserved_len = len;
+  reservation_id = ++reservation_seq;
+
+  r.buf = reserved_entry + LogConfig::SlotHeaderSize;
+  r.len = len;
+  r.id = reservation_id;
+
+  return ret_no_error();
+}
+
+int RdmaConsensus::commitReserved(Reservation const& r) {
+  if (r.id == 0 || r.id != reservation_id) {
+    return static_cast<int>(ProposeError::ReservationInvalid);
+  }
+
+  if (r.len > reserved_len) {
+    throw std::runtime_error("Committing more than the reserved space");
+  }
+
+  reservation_id = 0;
+
+  // Something else got proposed since the reservation
+  if (re_ctx->log.nextEntryPtr() != reserved_entry) {
+    return static_cast<int>(ProposeError::ReservationInvalid);
+  }
+
+  auto buf = reserved_entry + LogConfig::SlotHeaderSize;
+
+  // The unused part would look like garbage entries past the end of the log
+  memset(buf + r.len, 0, reserved_len - r.len);
+
+  if (likely(fast_path) && !re_ctx->log.ringBoundaryReached()) {
+    return await_durable(propose_impl(Log::InPlacePayload{buf, r.len}));
+  }
+
+  // The slow-path may adopt an older value at the very same place, and a
+  // recycling request would take it, so we fall back to a copy
+  std::vector<uint8_t> cmd(buf, buf + r.len);
+  memset(buf, 0, r.len);
+
+  auto ret = propose_impl(cmd.data(), cmd.size());
+  while (ret == ret_no_error() && payload_req_id == 0) {
+    ret = propose_impl(cmd.data(), cmd.size());
+  }
+
+  return await_durable(ret);
+}
+
+void RdmaConsensus::discard_reservation(bool own_log) {
+  reservation_id = 0;
+
+  // Leave the free part of the log zeroed, unless someone already wrote an
+  // entry there or the follower may be reading it
+  if (own_log && !ParsedSlot(reserved_entry).isPopulated()) {
+    memset(reserved_entry + LogConfig::SlotHeaderSize, 0, reserved_len);
+  }
+}
+
+template <typename Func>
+int RdmaConsensus::with_log(Func f) {
+  if (!consensus_thd.joinable()) {
+    throw std::runtime_error("Attach the commit handler first");
+  }
+
+  while (true) {
+    if (am_I_leader.load()) {
+      std::unique_lock<std::mutex> lock(follower.lock(), std::defer_lock);
+
+      if (!lock.try_lock()) {
+        auto& leader = leader_election->leaderSignal();
+        potential_leader = leader.load().requester;
+        return static_cast<int>(ProposeError::MutexUnavailable);
+      }
+
+      // The commands of the outstanding writes are already applied locally,
+      // they must reach a majority first
+      while (majW->outstandingWrites() > 0) {
+        if (!poll_fast_writes(lock)) {
+          return static_cast<int>(ProposeError::FastPath);
+        }
+      }
+
+      return f(true);
+    }
+
+    // Fails if the follower got blocked in the meantime, we may be the
+    // leader next time around
+    int ret = ret_no_error();
+    if (follower.runTask([&]() { ret = f(false); })) {
+      return ret;
+    }
+  }
+}
+
+int RdmaConsensus::takeSnapshot() {
+  if (!snapshots.enabled() || !snapshot_fn) {
+    throw std::runtime_error(
+        "Snapshots need a snapshot area and the snapshot handlers");
+  }
+
+  return with_log([this](bool) {
+    // The state must include every command committed so far
+    committer.drain();
+
+    auto& log = re_ctx->log;
+    auto fuo = progress.snapshot().applied_fuo;
+    if (fuo == 0) {  // Nothing committed yet
+      fuo = log.headerFirstUndecidedOffset();
+    }
+
+    if (!snapshots.store(snapshot_fn, log.ringPosition(fuo),
+                         committer.committedIndex())) {
+      return static_cast<int>(ProposeError::SnapshotUnavailable);
+    }
+
+    flusher->persistRange(snapshots.region(), snapshots.regionSize());
+
+    return ret_no_error();
+  });
+}
+
+int RdmaConsensus::installSnapshot(int from_id) {
+  if (!snapshots.enabled() || !restore_fn) {
+    throw std::runtime_error(
+        "Snapshots need a snapshot area and the snapshot handlers");
+  }
+
+  return with_log([this, from_id](bool leader) {
+    // After a restart, the snapshot kept in the durable log file
+    if (from_id == my_id) {
+      auto h = snapshots.current();
+      if (h.position == 0) {
+        return static_cast<int>(ProposeError::SnapshotUnavailable);
+      }
+
+      committer.drain();
+      restore_fn(snapshots.data(), h.length);
+      snapshots.publish(h);
+
+      return ret_no_error();
+    }
+
+    // Nobody has a more recent state than the leader
+    if (leader) {
+      return static_cast<int>(ProposeError::SnapshotUnavailable);
+    }
+
+    auto& log = re_ctx->log;
+    auto local = log.ringPosition(progress.snapshot().applied_fuo);
+
+    if (!follower.fetchSnapshot(from_id)) {
+      return static_cast<int>(ProposeError::SnapshotUnavailable);
+    }
+
+    // The entries in between are applied already, they would be lost
+    auto const& h = snapshots.current();
+    if (h.position < local) {
+      return static_cast<int>(ProposeError::SnapshotUnavailable);
+    }
+
+    committer.drain();
+    restore_fn(snapshots.data(), h.length);
+
+    return ret_no_error();
+  });
+}
+
+template <typename Emit>
+int RdmaConsensus::export_log(Emit emit, uint64_t& seq) {
+  if (!index_log) {
+    throw std::runtime_error("Exporting the log needs MemoryConfig::indexLog");
+  }
+
+  // One chunk at a time with the log to ourselves, it cannot be reclaimed
+  // while it is written out
+  while (true) {
+    bool done = false;
+    auto ret = with_log([&](bool) {
+      LogStream::RangeHeader range;
+      uint8_t* data = nullptr;
+
+      switch (LogStream::collect(re_ctx->log, seq,
+                                 ConsensusConfig::exportChunk, range, data)) {
+        case LogStream::Reclaimed:
+          return static_cast<int>(ProposeError::StreamUnavailable);
+        case LogStream::Done:
+          done = true;
+          return ret_no_error();
+        case LogStream::Collected:
+          break;
+        default:
+          throw std::runtime_error("Unreachable, software bug");
+      }
+
+      emit(range, data);
+      seq += range.entries;
+      return ret_no_error();
+    });
+
+    if (ret != ret_no_error() || done) {
+      return ret;
+    }
+  }
+}
+
+int RdmaConsensus::exportLog(int fd, uint64_t& seq) {
+  return export_log(
+      [fd](LogStream::RangeHeader const& range, uint8_t const* data) {
+        LogStream::write(fd, range, data);
+      },
+      seq);
+}
+
+int RdmaConsensus::exportLog(
+    std::function<void(uint8_t const* buf, size_t len)> const& sink,
+    uint64_t& seq) {
+  return export_log(
+      [&sink](LogStream::RangeHeader const& range, uint8_t const* data) {
+        sink(reinterpret_cast<uint8_t const*>(&range), sizeof(range));
+        sink(data, range.length);
+      },
+      seq);
+}
+
+int RdmaConsensus::importLog(int fd) {
+  LogStream::Reader reader(fd);
+  LogStream::RangeHeader range;
+  uint8_t* data = nullptr;
+
+  while (reader.next(range, data)) {
+    auto ret = with_log([&](bool leader) {
+      // The leader applied everything it has, replaying would apply twice
+      if (leader) {
+        return static_cast<int>(ProposeError::StreamUnavailable);
+      }
+
+      // What the local log already committed went through the commit
+      // handler, only the rest of the stream is new to the application
+      auto& log = re_ctx->log;
+      auto applied = log.ringPosition(progress.snapshot().applied_fuo);
+
+      auto end = data + range.length;
+      for (auto entry = data; entry < end;) {
+        ParsedSlot pslot(entry);
+        auto position = range.position + static_cast<uint64_t>(entry - data);
+
+        if (position >= applied && !snapshots.covers(position)) {
+          pslot.forEachRecord(
+              [this](uint8_t* buf, size_t len) { committer.append(buf, len); });
+        }
+
+        entry += LogConfig::round_up_powerof2(pslot.totalLength());
+      }
+
+      // The commands point inside the reader's buffer
+      committer.flush(false);
+      committer.drain();
+      snapshots.cover(range.position + range.length);
+
+      return ret_no_error();
+    });
+
+    if (ret != ret_no_error()) {
+      return ret;
+    }
+  }
+
+  return ret_no_error();
+}
+
+int RdmaConsensus::advance_ring(std::unique_lock<std::mutex>& lock,
+                                std::atomic<Leader>& leader) {
+  auto& log = re_ctx->log;
+
+  // The request commits everything that precedes it
+  if (!poll_fast_writes(lock)) {
+    return static_cast<int>(ProposeError::FastPath);
+  }
+
+  // The replies to the previous request prove that every replica zeroed the
+  // segment we are entering. Without one (new leader), we wait for the replies
+  // to this request instead.
+  bool first = !log_recycling->pending();
+  bool unanswered = log_recycling->unanswered();
+  if (!log_recycling->waitForReplies(leader)) {
+    if (!unanswered) {
+      LOGGER_WARN(logger, "A replica did not answer the previous recycling "
+                          "request");
+    }
+    return ret_error(lock, ProposeError::RecyclingUnanswered);
+  }
+
+  auto wrap = log.spaceLeftCritical();
+  auto local_fuo = log.headerFirstUndecidedOffset();
+  auto recycling_req = log_recycling->generateRequest(
+      local_fuo, log.ringPosition(local_fuo), wrap);
+
+  // The commands point inside the log
+  committer.drain();
+  reclaimer->reclaimUpTo(recycling_req.reclaim_up_to);
+
+  Slot slot(log);
+  slot.storeAcceptedProposal(proposal_nr);
+  slot.storeFirstUndecidedOffset(0);
+  slot.storePayload(reinterpret_cast<uint8_t*>(&recycling_req),
+                    sizeof(recycling_req));
+
+  auto [address, offset, size] = slot.location();
+  auto posted_at = LeaseClock::now();
+  auto ok = majW->fastWrite(address, size, to_remote_memory, offset, leader, 0,
+                            use_tofino);
+
+  if (!ok) {
+    LOGGER_TRACE(logger,
+                 "Error in log recycling: occurred when writing the request "
+                 "to a majority");
+    auto err = majW->fastWriteError();
+    majW->recoverFromError(err);
+
+    return ret_error(lock, ProposeError::FastPath, true);
+  }
+
+  flusher->written(
+      log.ringPosition(LogConfig::round_up_powerof2(offset + size)),
+      proposal_nr);
+
+  if (wrap) {
+    log.wrap(log.tailOffset());
+
+    iter = log.blockingIterator();
+    commit_iter = log.liveIterator();
+    lsr = std::make_unique<LogSlotReader>(re_ctx.get(), *scratchpad.get(),
+                                          log.headerFirstUndecidedOffset());
+    flusher->committed(log.ringPosition(log.headerFirstUndecidedOffset()));
+    progress.committed(log.headerFirstUndecidedOffset(), 0, posted_at);
+  } else {
+    // An entry like any other, the next one commits it
+    log.updateHeaderFirstUndecidedOffset(
+        LogConfig::round_up_powerof2(offset + size));
+    iter.sampleNext();
+    log.enterSegment(log.segmentOf(offset));
+  }
+
+  if (first && !log_recycling->waitForReplies(leader)) {
+    LOGGER_WARN(logger, "A replica did not answer the first recycling request "
+                        "of this leadership");
+    return ret_error(lock, ProposeError::RecyclingUnanswered);
+  }
+
+  return ret_no_error();
+}
+
+int RdmaConsensus::await_durable(int ret) {
+  if (ret != ret_no_error() || written_up_to == 0 ||
+      !flusher->majorityDurable()) {
+    return ret;
+  }
+
+  // The leader flushed its own log before propose_impl returned
+  auto& leader = leader_election->leaderSignal();
+  if (durable.waitFor(proposal_nr, written_up_to, leader)) {
+    return ret;
+  }
+
+  LOGGER_WARN(logger, "A majority did not confirm flushing the log up to {}",
+              written_up_to);
+  std::unique_lock<std::mutex> lock(follower.lock(), std::defer_lock);
+  return ret_error(lock, ProposeError::FlushUnconfirmed);
+}
+
+template <typename... Payload>
+int RdmaConsensus::propose_impl(Payload const&... payload) {
   //std::cout << "================================About to propose================================ " << std::endl;
   //std::cout <<"Checking the state of the replication qp" << std::endl;
   //re_ctx->cc.ce.check_all_qp_states();
   
+  payload_req_id = 0;
+  written_up_to = 0;
   std::unique_lock<std::mutex> lock(follower.lock(), std::defer_lock);
   
   if (!lock.try_lock()) {
@@ -250,22 +1169,34 @@ int RdmaConsensus::propose(uint8_t* buf, size_t buf_len) {
   if (likely(fast_path) && likely(am_I_leader.load())) {
     auto& leader = leader_election->leaderSignal();
 
+    if (unlikely(re_ctx->log.ringBoundaryReached())) {
+      auto ret = advance_ring(lock, leader);
+      if (ret != ret_no_error()) {
+        return ret;
+      }
+    }
+
     //on enregistre la valeur dans notre lof
     auto local_fuo = re_ctx->log.headerFirstUndecidedOffset();
-    Slot slot(re_ctx->log, proposal_nr, local_fuo, buf, buf_len);
-    auto [address, offset, size] = slot.location();
 
     //on écrit dans celui des autres
-    auto ok = majW->fastWrite(address, size, to_remote_memory, offset, leader,
-                              outstanding_req, use_tofino);
+    auto posted_at = LeaseClock::now();
+    auto [ok, offset, size] = fast_write(local_fuo, leader, payload...);
 
       
     if (likely(ok)) {
+      payload_req_id = majW->range_start;
+      acked_up_to.store(majW->latestReplicatedID());
+      track_lease(posted_at, payload_req_id);
+      renew_lease();
       //on avance le fuo
       auto fuo = LogConfig::round_up_powerof2(offset + size);
       re_ctx->log.updateHeaderFirstUndecidedOffset(fuo);
+      written_up_to = re_ctx->log.ringPosition(fuo);
+      flusher->written(written_up_to, proposal_nr);
       auto has_next = iter.sampleNext();
       if (has_next) {
+        progress.received();
         ParsedSlot pslot(iter.location());
 
         LOGGER_TRACE(logger, "Accepted proposal: {}, FUO: {}",
@@ -273,13 +1204,18 @@ int RdmaConsensus::propose(uint8_t* buf, size_t buf_len) {
 
         // Now that I got something, I will use the commit iterator
         //(pk c'est pas le follower thread qui s'en occupe ?)
+        // Before the application sees the commands, see canServeLocalRead
+        applied_up_to.store(payload_req_id + 1);
+        uint64_t committed_entries = 0;
         while (commit_iter.hasNext(fuo)) {
           commit_iter.next();
+          committed_entries++;
 
-          ParsedSlot pslot(commit_iter.location());
-          auto [buf, len] = pslot.payload();
-          commit(true, buf, len);
+          commit_entry(commit_iter.location());
         }
+        committer.flush(true);
+        flusher->committed(re_ctx->log.ringPosition(fuo));
+        progress.committed(fuo, committed_entries, posted_at);
       }
     } else {
 
@@ -303,6 +1239,7 @@ int RdmaConsensus::propose(uint8_t* buf, size_t buf_len) {
       became_leader = false;
       LOGGER_TRACE(logger, "Rebuilding log");
       re_ctx->log.rebuildLog();
+      log_recycling->forgetPending();
     }
 
     // Hanging workaround
@@ -310,22 +1247,29 @@ int RdmaConsensus::propose(uint8_t* buf, size_t buf_len) {
 
     if (likely(fast_path)) {  // Fast-path
       //std :: cout << "in the fast path "<< std :: endl;
-      if (unlikely(re_ctx->log.spaceLeftCritical())) {
-        return ret_error(lock, ProposeError::FastPathRecyclingTriggered);
+      if (unlikely(re_ctx->log.ringBoundaryReached())) {
+        auto ret = advance_ring(lock, leader);
+        if (ret != ret_no_error()) {
+          return ret;
+        }
       }
 
       auto local_fuo = re_ctx->log.headerFirstUndecidedOffset();
-      Slot slot(re_ctx->log, proposal_nr, local_fuo, buf, buf_len);
-      auto [address, offset, size] = slot.location();
-
-      auto ok = majW->fastWrite(address, size, to_remote_memory, offset, leader,
-                                outstanding_req, use_tofino);
+      auto posted_at = LeaseClock::now();
+      auto [ok, offset, size] = fast_write(local_fuo, leader, payload...);
 
       if (likely(ok)) {
+        payload_req_id = majW->range_start;
+        acked_up_to.store(majW->latestReplicatedID());
+        track_lease(posted_at, payload_req_id);
+        renew_lease();
         auto fuo = LogConfig::round_up_powerof2(offset + size);
         re_ctx->log.updateHeaderFirstUndecidedOffset(fuo);
+        written_up_to = re_ctx->log.ringPosition(fuo);
+        flusher->written(written_up_to, proposal_nr);
         auto has_next = iter.sampleNext();
         if (has_next) {
+          progress.received();
           ParsedSlot pslot(iter.location());
 
           LOGGER_TRACE(logger, "Accepted proposal: {}, FUO: {}",
@@ -333,14 +1277,18 @@ int RdmaConsensus::propose(uint8_t* buf, size_t buf_len) {
           
 
           // Now that I got something, I will use the commit iterator
+          // Before the application sees the commands, see canServeLocalRead
+          applied_up_to.store(payload_req_id + 1);
+          uint64_t committed_entries = 0;
           while (commit_iter.hasNext(fuo)) {
             commit_iter.next();
+            committed_entries++;
 
-            ParsedSlot pslot(commit_iter.location());
-            auto [buf, len] = pslot.payload();
-            commit(true, buf, len);
+            commit_entry(commit_iter.location());
           }
-          
+          committer.flush(true);
+          flusher->committed(re_ctx->log.ringPosition(fuo));
+          progress.committed(fuo, committed_entries, posted_at);
         }
       } else {
         LOGGER_TRACE(logger,
@@ -477,6 +1425,7 @@ int RdmaConsensus::propose(uint8_t* buf, size_t buf_len) {
         LOGGER_TRACE(logger, "Proposing the freshest value in the slow-path");
 
         auto size = ParsedSlot::copy(local_fuo_entry, freshest);
+        re_ctx->log.indexEntry(local_fuo_entry);
         // TODO (Check that): These lines are necessary
         ParsedSlot fresh_pslot(local_fuo_entry);
         fresh_pslot.setAcceptedProposal(proposal_nr);
@@ -489,6 +1438,7 @@ int RdmaConsensus::propose(uint8_t* buf, size_t buf_len) {
         std::transform(to_remote_memory.begin(), to_remote_memory.end(),
                        dest.begin(),
                        bind2nd(std::plus<uintptr_t>(), local_fuo));
+        auto posted_at = LeaseClock::now();
         auto err = majW->write(local_fuo_entry, size, dest, leader);
 
         if (!err->ok()) {
@@ -497,8 +1447,11 @@ int RdmaConsensus::propose(uint8_t* buf, size_t buf_len) {
         } else {
           auto fuo = LogConfig::round_up_powerof2(local_fuo + size);
           re_ctx->log.updateHeaderFirstUndecidedOffset(fuo);
+          written_up_to = re_ctx->log.ringPosition(fuo);
+          flusher->written(written_up_to, proposal_nr);
           auto has_next = iter.sampleNext();
           if (has_next) {
+            progress.received();
             ParsedSlot pslot(iter.location());
 
             LOGGER_TRACE(logger, "Accepted proposal: {}, FUO: {}",
@@ -507,13 +1460,16 @@ int RdmaConsensus::propose(uint8_t* buf, size_t buf_len) {
             // auto [buf, len] = pslot.payload();
 
             // Now that I got something, I will use the commit iterator
+            uint64_t committed_entries = 0;
             while (commit_iter.hasNext(fuo)) {
               commit_iter.next();
+              committed_entries++;
 
-              ParsedSlot pslot(commit_iter.location());
-              auto [buf, len] = pslot.payload();
-              commit(true, buf, len);
+              commit_entry(commit_iter.location());
             }
+            committer.flush(true);
+            flusher->committed(re_ctx->log.ringPosition(fuo));
+            progress.committed(fuo, committed_entries, posted_at);
           }
         }
 
@@ -521,48 +1477,12 @@ int RdmaConsensus::propose(uint8_t* buf, size_t buf_len) {
         fast_path = true;
         LOGGER_TRACE(logger, "Proposing the new value in the slow-path");
 
-        // std::cout << "Space left " << re_ctx->log.spaceLeft() << std::endl;
-        if (unlikely(re_ctx->log.spaceLeftCritical())) {
-          // Send log recycle request in the form:
-          Slot slot(re_ctx->log);
-          slot.storeAcceptedProposal(proposal_nr);
-          slot.storeFirstUndecidedOffset(0);
-          // std::cout << "Sending recycling request with fuo:" << local_fuo <<
-          // std::endl;
-          auto recycling_req = log_recycling->generateRequest(local_fuo);
-          slot.storePayload(reinterpret_cast<uint8_t*>(&recycling_req),
-                            sizeof(recycling_req));
-
-          auto [address, offset, size] = slot.location();
-          std::transform(to_remote_memory.begin(), to_remote_memory.end(),
-                         dest.begin(), bind2nd(std::plus<uintptr_t>(), offset));
-          auto err = majW->write(address, size, dest, leader);
-
-          if (!err->ok()) {
-            majW->recoverFromError(err);
-            return ret_error(lock, ProposeError::SlowPathWriteNewValue, true);
-          } else {
-            re_ctx->log.resetFUO();
-            re_ctx->log.rebuildLog();
-
-            iter = re_ctx->log.blockingIterator();
-            commit_iter = re_ctx->log.liveIterator();
-
-            auto next_log_entry_offset =
-                re_ctx->log.headerFirstUndecidedOffset();
-            lsr = std::make_unique<LogSlotReader>(
-                re_ctx.get(), *scratchpad.get(), next_log_entry_offset);
-
-            // Wait for all to clean-up their log
-            log_recycling->waitForReplies();
-
-            re_ctx->log.bzero();
-
-            // std::cout << "Sleeping..." << std::endl;
-            // std::this_thread::sleep_for(std::chrono::seconds(2));
-
-            return ret_error(lock, ProposeError::SlowPathLogRecycled);
+        if (unlikely(re_ctx->log.ringBoundaryReached())) {
+          auto ret = advance_ring(lock, leader);
+          if (ret != ret_no_error()) {
+            return ret;
           }
+          local_fuo = re_ctx->log.headerFirstUndecidedOffset();
         }
 
         Slot slot(re_ctx->log);
@@ -570,22 +1490,27 @@ int RdmaConsensus::propose(uint8_t* buf, size_t buf_len) {
         // TODO: Are these values correct?
         slot.storeAcceptedProposal(proposal_nr);
         slot.storeFirstUndecidedOffset(local_fuo);
-        slot.storePayload(buf, buf_len);
+        slot.storePayload(payload...);
 
         auto [address, offset, size] = slot.location();
 
         std::transform(to_remote_memory.begin(), to_remote_memory.end(),
                        dest.begin(), bind2nd(std::plus<uintptr_t>(), offset));
+        auto posted_at = LeaseClock::now();
         auto err = majW->write(address, size, dest, leader);
 
         if (!err->ok()) {
           majW->recoverFromError(err);
           return ret_error(lock, ProposeError::SlowPathWriteNewValue, true);
         } else {
+          payload_req_id = majW->range_start;
           auto fuo = LogConfig::round_up_powerof2(offset + size);
           re_ctx->log.updateHeaderFirstUndecidedOffset(fuo);
+          written_up_to = re_ctx->log.ringPosition(fuo);
+          flusher->written(written_up_to, proposal_nr);
           auto has_next = iter.sampleNext();
           if (has_next) {
+            progress.received();
             ParsedSlot pslot(iter.location());
 
             LOGGER_TRACE(logger, "Accepted proposal: {}, FUO: {}",
@@ -594,13 +1519,16 @@ int RdmaConsensus::propose(uint8_t* buf, size_t buf_len) {
             // auto [buf, len] = pslot.payload();
 
             // Now that I got something, I will use the commit iterator
+            uint64_t committed_entries = 0;
             while (commit_iter.hasNext(fuo)) {
               commit_iter.next();
+              committed_entries++;
 
-              ParsedSlot pslot(commit_iter.location());
-              auto [buf, len] = pslot.payload();
-              commit(true, buf, len);
+              commit_entry(commit_iter.location());
             }
+            committer.flush(true);
+            flusher->committed(re_ctx->log.ringPosition(fuo));
+            progress.committed(fuo, committed_entries, posted_at);
           }
         }
       }
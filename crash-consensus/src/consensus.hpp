@@ -1,8 +1,11 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <deque>
 #include <thread>
+#include <tuple>
 #include <vector>
 
 #include <dory/conn/exchanger.hpp>
@@ -14,38 +17,212 @@
 #include <dory/store.hpp>
 
 #include "branching.hpp"
+#include "committer.hpp"
 #include "config.hpp"
+#include "durable-quorum.hpp"
+#include "log-stream.hpp"
 #include "log.hpp"
 #include "logger.hpp"
+#include "mapped-file.hpp"
 #include "memory.hpp"
 #include "pinning.hpp"
+#include "progress-tracker.hpp"
 #include "response-tracker.hpp"
 #include "slow-path.hpp"
+#include "snapshot.hpp"
+#include "submission-ring.hpp"
 
 #include <random>  // TODO: Remove if leader-switch is finished
 #include "follower.hpp"
 #include "leader-switch.hpp"
+#include "log-flusher.hpp"
+#include "log-reclaimer.hpp"
 #include "log-recycling.hpp"
 #include "readerwriterqueue.h"
 
 namespace dory {
+struct ConsensusOptions;
+
 class RdmaConsensus {
  public:
   RdmaConsensus(int my_id, std::vector<int> &remote_ids,
                 int outstanding_req = 0,
                 bool want_tofino = false,
                 ConsensusConfig::ThreadConfig threadConfig =
-                    ConsensusConfig::ThreadConfig());
+                    ConsensusConfig::ThreadConfig(),
+                ConsensusConfig::MemoryConfig memoryConfig =
+                    ConsensusConfig::MemoryConfig());
   ~RdmaConsensus();
 
   template <typename Func> void commitHandler(Func f) {
-    commit = std::move(f);
-    follower.commitHandler(commit);
+    committer.entryHandler(std::move(f));
     spawn_follower(); //launches consensus_thd
   }
 
+  // Alternative to commitHandler: receives, in one call, all the commands
+  // committed between the old and the new FUO
+  void commitBatchHandler(Committer::BatchHandler f) {
+    committer.batchHandler(std::move(f));
+    spawn_follower();
+  }
+
+  // Opt-in, to call before attaching the commit handler: the handler runs on
+  // a dedicated apply thread, propose returns once the quorum is reached
+  // without waiting for the application.
+  void applyInBackground() { committer.applyInBackground(threadConfig); }
+
+  // Number of commands committed so far, and waiting until the application
+  // has seen the first `index` of them (read-after-write)
+  inline uint64_t committedIndex() const { return committer.committedIndex(); }
+  inline void waitApplied(uint64_t index) const {
+    committer.waitApplied(index);
+  }
+
   int propose(uint8_t *buf, size_t len);
 
+  // Proposes the concatenation of the buffers as a single command. Buffers
+  // that lie in memory given to registerMemory are sent to the replicas
+  // straight from there (one multi-SGE write per replica), the local copy of
+  // the entry is filled while the NIC reads them. Such a propose returns
+  // once every replica has its write, even with outstanding_req, so the
+  // buffers can be reused right away.
+  int propose(struct iovec const *iov, int iovcnt);
+  void registerMemory(void *addr, size_t len);
+
+  // Packs all the commands as sub-records of a single log entry, which is
+  // replicated with one write per replica. The commit handler still fires
+  // once per command.
+  int proposeBatch(std::vector<std::pair<uint8_t *, size_t>> &cmds);
+
+  // Same as propose, but returns as soon as the entry is posted to the
+  // replicas (up to `outstanding_req` entries can be in flight). `ticket`
+  // identifies the entry in poll()/wait() and in the completion handler.
+  // Tickets are strictly increasing, 0 is never issued.
+  int proposeAsync(uint8_t *buf, size_t len, uint64_t &ticket);
+
+  // Called with (ticket, committed) once the fate of the entry is known:
+  // committed is false if leadership was lost or the replication failed
+  // before a majority acknowledged it.
+  template <typename Func> void completionHandler(Func f) {
+    completion = std::move(f);
+  }
+
+  // Consumes the available work completions without blocking and resolves
+  // the tickets. Returns the number of tickets resolved.
+  // poll/wait must be called from the thread that calls proposeAsync.
+  int poll();
+
+  // Polls until `ticket` is resolved. Returns whether it was committed.
+  bool wait(uint64_t ticket);
+
+  // Zero-copy proposals: `buf` points directly at the payload of the next log
+  // entry, the application serializes its command there and hands it over
+  // with commitReserved. Only one reservation can be outstanding, any other
+  // proposal or a change of leadership invalidates it.
+  struct Reservation {
+    uint8_t *buf;
+    size_t len;  // Can be shrunk before committing
+    uint64_t id;
+  };
+
+  int reserve(size_t len, Reservation &r);
+  int commitReserved(Reservation const &r);
+
+  // Proposes from any thread: the command goes through the submission ring
+  // and handover_thd (started by spawnHandover) proposes it, coalescing the
+  // commands that arrive together (group commit, see ConsensusConfig).
+  inline int submit(uint8_t *buf, size_t len) {
+    return submissions.submit(buf, len);
+  }
+
+  void spawnHandover();
+
+  struct GroupCommitStats {
+    uint64_t entries;   // Log entries proposed by handover_thd
+    uint64_t commands;  // Commands they contained
+    uint64_t max_batch;
+  };
+
+  GroupCommitStats groupCommitStats() const {
+    return GroupCommitStats{gc_entries.load(), gc_commands.load(),
+                            gc_max_batch.load()};
+  }
+
+  // Leader read lease (see ConsensusConfig::leaderLeaseNs): while it holds,
+  // no other process can commit, so reads can be answered from the local
+  // state without going through the log. Not while the leader has applied
+  // commands that a majority may not have yet. Can be called from any thread.
+  bool canServeLocalRead();
+
+  // Returns NoError once local reads are linearizable: right away while the
+  // lease holds, otherwise after renewing it with a write to a majority.
+  // Called from the thread that proposes. With applyInBackground, also wait
+  // for waitApplied(committedIndex()) before reading.
+  int readBarrier();
+
+  // How far this replica has committed, published on every replica
+  inline ProgressTracker::Snapshot replicaProgress() const {
+    return progress.snapshot();
+  }
+
+  // Bounded-staleness reads, on any replica: true if the local state misses
+  // at most `max_lag_entries` of the log entries received so far and includes
+  // everything the leader committed more than `max_lag_us` ago (plus one
+  // network delay). Followers commit an entry when they receive the next
+  // one, so they always lag by at least one entry, and an idle leader makes
+  // them look stale. Can be called from any thread, with applyInBackground
+  // also wait for waitApplied(committedIndex()) before reading.
+  bool canServeStaleRead(uint64_t max_lag_entries, uint64_t max_lag_us);
+
+  // Snapshots of the application (MemoryConfig::snapshotSize must be set).
+  // `snapshot` serializes the state, `restore` replaces it. Both are called
+  // with the log to ourselves: on the leader from the proposing thread, on a
+  // follower from its thread, and never concurrently with the commit handler
+  // (with applyInBackground, once everything committed is applied).
+  void snapshotHandlers(SnapshotStore::Snapshotter snapshot,
+                        SnapshotStore::Restorer restore) {
+    snapshot_fn = std::move(snapshot);
+    restore_fn = std::move(restore);
+  }
+
+  // Stores a snapshot that covers everything committed so far, where the
+  // other replicas can read it. Attach the commit handler first.
+  int takeSnapshot();
+
+  // On a follower whose application lost (or never had) its state: restores
+  // the snapshot of `from_id`, read by RDMA, and skips the log entries it
+  // covers. Fails with SnapshotUnavailable if `from_id` has none, if it is
+  // older than the local state, or on the leader. With `from_id == my_id`,
+  // restores the snapshot a durable log kept across a restart instead.
+  int installSnapshot(int from_id);
+
+  // Ring position (Log::ringPosition) up to which the local snapshot goes,
+  // and the number of commands it includes
+  inline std::pair<uint64_t, uint64_t> snapshotCoverage() const {
+    auto h = snapshots.current();
+    return std::make_pair(h.position, h.applied);
+  }
+
+  // Streams the committed entries from sequence number `seq` (see LogIndex,
+  // entries are numbered from start up) to `fd`, or to `sink` (range header,
+  // then the entries), and moves `seq` past them. Fails with
+  // StreamUnavailable if the entry `seq` is reclaimed already.
+  int exportLog(int fd, uint64_t &seq);
+  int exportLog(
+      std::function<void(uint8_t const *buf, size_t len)> const &sink,
+      uint64_t &seq);
+
+  // On a follower: replays the commands of an exported stream through the
+  // commit handler, and skips them when they reach the local log. Entries the
+  // follower already applied are skipped. Fails with StreamUnavailable on the
+  // leader.
+  int importLog(int fd);
+
+  // Cost of keeping the log durable (MemoryConfig::logPath)
+  inline LogFlusher::Stats flushStats() const {
+    return flusher ? flusher->stats() : LogFlusher::Stats{0, 0, 0, 0};
+  }
+
   inline int potentialLeader() { return potential_leader; }
 
   inline std::pair<uint64_t, uint64_t> proposedReplicatedRange() {
@@ -65,7 +242,13 @@ class RdmaConsensus {
     SlowPathWriteAdoptedValue,
     SlowPathWriteNewValue,
     FollowerMode,
-    SlowPathLogRecycled
+    SlowPathLogRecycled,
+    ReservationInvalid,
+    LeaseUnavailable,
+    SnapshotUnavailable,
+    StreamUnavailable,
+    RecyclingUnanswered,
+    FlushUnconfirmed
   };
 
   bool isTofinoUsed(){return use_tofino;}
@@ -74,11 +257,51 @@ class RdmaConsensus {
  private:
   void spawn_follower();
   void run();
+  void size_queues();
+
+  template <typename... Payload>
+  int propose_impl(Payload const &...payload);
+
+  // Reports what propose_impl returned once a majority flushed what it wrote
+  // (PerEntry, PerBatch)
+  int await_durable(int ret);
+
+  // Stores the entry in the local log and posts it to the replicas
+  template <typename... Payload>
+  std::tuple<bool, ptrdiff_t, size_t> fast_write(uint64_t local_fuo,
+                                                 std::atomic<Leader> &leader,
+                                                 Payload const &...payload) {
+    Slot slot(re_ctx->log, proposal_nr, local_fuo, payload...);
+    auto [address, offset, size] = slot.location();
+
+    auto ok = majW->fastWrite(address, size, to_remote_memory, offset, leader,
+                              outstanding_req, use_tofino);
+    return std::make_tuple(ok, offset, size);
+  }
+
+  std::tuple<bool, ptrdiff_t, size_t> fast_write(
+      uint64_t local_fuo, std::atomic<Leader> &leader,
+      Log::GatherPayload const &payload);
+
+  bool lkey_of(void *addr, size_t len, uint32_t &lkey);
 
   inline int ret_error(std::unique_lock<std::mutex> &lock, ProposeError error,
                        bool ask_connection_reset = false) {
     became_leader = true;
 
+    // Recycling keeps the in-flight writes valid, anything else means the
+    // outstanding async proposals cannot be trusted anymore
+    if (error != FastPathRecyclingTriggered && error != SlowPathLogRecycled) {
+      failed_up_to = last_ticket;
+    }
+
+    if (reservation_id != 0) {
+      discard_reservation(lock.owns_lock());
+    }
+
+    lease_expiry.store(0);
+    lease_pending = false;
+
     if (ask_connection_reset) {
       ask_reset.store(true);
       lock.unlock();
@@ -93,30 +316,133 @@ class RdmaConsensus {
 
   inline int ret_no_error() { return 0; }
 
+  void discard_reservation(bool own_log);
+
+  // Hands the commands of a committed entry to the committer, unless the
+  // restored snapshot already has them
+  inline void commit_entry(uint8_t *entry) {
+    auto &log = re_ctx->log;
+    if (unlikely(snapshots.covers(log.ringPosition(entry - log.headerPtr())))) {
+      return;
+    }
+
+    ParsedSlot(entry).forEachRecord(
+        [this](uint8_t *buf, size_t len) { committer.append(buf, len); });
+  }
+
+  // Runs `f` with the log to ourselves: here on the leader, on the follower
+  // thread otherwise
+  template <typename Func>
+  int with_log(Func f);
+
+  template <typename Emit>
+  int export_log(Emit emit, uint64_t &seq);
+
+  using LeaseClock = std::chrono::steady_clock;
+
+  // The lease starts when a write that reaches a majority was posted. Only
+  // one write is tracked at a time, renew_lease extends the lease once it is
+  // replicated.
+  inline void track_lease(LeaseClock::time_point posted_at, uint64_t req_id) {
+    if (!lease_pending) {
+      lease_pending = true;
+      lease_posted_at = posted_at;
+      lease_req_id = req_id;
+    }
+  }
+
+  inline void renew_lease() {
+    if (lease_pending && majW->latestReplicatedID() > lease_req_id) {
+      lease_pending = false;
+      extend_lease(lease_posted_at);
+    }
+  }
+
+  inline void extend_lease(LeaseClock::time_point posted_at) {
+    auto expiry = posted_at + std::chrono::nanoseconds(
+                                  ConsensusConfig::leaderLeaseNs);
+    lease_expiry.store(expiry.time_since_epoch().count());
+  }
+
+  bool poll_fast_writes(std::unique_lock<std::mutex> &lock);
+
+  // Writes the recycling request that opens the next segment of the log, or
+  // wraps around at the end of the lap (see LogRecycling)
+  int advance_ring(std::unique_lock<std::mutex> &lock,
+                   std::atomic<Leader> &leader);
+  bool replication_idle();
+  void serve_submissions();
+
  public:
+  // Application threads submit through the ring, handover_thd proposes
   std::thread handover_thd;
-  std::atomic<bool> handover;
-  uint8_t *handover_buf;
-  size_t handover_buf_len;
-  int handover_ret;
+  SubmissionRing submissions{ConsensusConfig::submissionRingSize};
 
  private:
   int my_id;
   std::vector<int> remote_ids;
 
-  size_t allocated_size; //par défaut (dans le constructeurs, dans consensus.cpp) à 2GiB
+  size_t allocated_size; //par défaut ConsensusConfig::defaultLogSize (2GiB)
   int alignment; //par défaut à 64
+  ConsensusConfig::HugePages huge_pages;
+  size_t snapshot_size;
+  std::string log_path;  // Empty if the log is volatile
+  ConsensusConfig::FlushPolicy flush_policy;
+  bool index_log;
+  int populate_threads;
+  int send_queue_depth;  // 0 until sized by run()
+  int cq_depth;
 
   std::thread consensus_thd;
   std::thread permissions_thd;
 
   std::atomic<bool> am_I_leader;
 
-  std::function<void(bool, uint8_t *, size_t)> commit;
+  Committer committer;
+  ProgressTracker progress;
+  std::function<void(uint64_t, bool)> completion;
+
+  SnapshotStore snapshots;
+  SnapshotStore::Snapshotter snapshot_fn;
+  SnapshotStore::Restorer restore_fn;
+
+  // Async proposals: (ticket, req id of the write in majW, ring position of
+  // the end of the entry), in ticket order
+  std::deque<std::tuple<uint64_t, uint64_t, uint64_t>> pending_tickets;
+  std::vector<std::pair<uint64_t, uint64_t>> failed_tickets;  // [from, to]
+  uint64_t last_ticket = 0;
+  uint64_t failed_up_to = 0;
+  uint64_t payload_req_id = 0;  // 0 if propose_impl did not write the payload
+  uint64_t written_up_to = 0;   // Ring position, 0 if propose_impl wrote nothing
+
+  // Group commit
+  std::vector<std::pair<uint8_t *, size_t>> gc_cmds;
+  std::atomic<uint64_t> gc_entries{0};
+  std::atomic<uint64_t> gc_commands{0};
+  std::atomic<uint64_t> gc_max_batch{0};
+
+  // Read lease, in LeaseClock ticks (0 if none)
+  std::atomic<LeaseClock::rep> lease_expiry{0};
+
+  // The leader applies an entry as soon as its write is posted. Local reads
+  // wait until a majority has every write applied so far (fast-path
+  // request ids, one past the last).
+  std::atomic<uint64_t> applied_up_to{0};
+  std::atomic<uint64_t> acked_up_to{0};
+  bool lease_pending = false;
+  LeaseClock::time_point lease_posted_at;
+  uint64_t lease_req_id = 0;
+
+  // The outstanding reservation (id 0 if none)
+  uint64_t reservation_id = 0;
+  uint64_t reservation_seq = 0;
+  uint8_t *reserved_entry = nullptr;
+  size_t reserved_len = 0;
 
   Devices d;
   OpenDevice od;
   std::unique_ptr<ResolvedPort> rp;
+  std::unique_ptr<MappedFile> log_file;  // Registered memory of a durable log
   std::unique_ptr<ControlBlock> cb;
   std::unique_ptr<ConnectionExchanger> ce_replication;
   std::unique_ptr<ConnectionExchanger> ce_leader_election;
@@ -130,11 +456,19 @@ class RdmaConsensus {
   std::unique_ptr<CatchUpWithFollowers> catchup;
   std::unique_ptr<LogSlotReader> lsr;
   std::unique_ptr<LogRecycling> log_recycling;
+  std::unique_ptr<LogReclaimer> reclaimer;
+  std::unique_ptr<LogFlusher> flusher;
+  DurableQuorum durable;
   std::unique_ptr<SequentialQuorumWaiter> sqw;
   std::unique_ptr<
       FixedSizeMajorityOperation<SequentialQuorumWaiter, WriteLogMajorityError>>  majW;
 
   std::vector<uintptr_t> to_remote_memory, dest;
+  std::vector<uintptr_t> to_remote_lease;
+
+  // Memory the gathered proposals can be sent from, the log's MR first
+  std::vector<ControlBlock::MemoryRegion> send_regions;
+  std::vector<struct ibv_sge> gather_sges;
   BlockingIterator iter; 
   LiveIterator commit_iter;
 
@@ -161,4 +495,8 @@ class RdmaConsensus {
  public:
   std::atomic<bool> *response_blocked;
 };
+
+// Defined with Consensus (crash-consensus.cpp), shared with the C interface
+RdmaConsensus *newRdmaConsensus(int my_id, std::vector<int> &remote_ids,
+                                ConsensusOptions const &options);
 }  // namespace dory
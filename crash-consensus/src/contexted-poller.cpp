@@ -1,16 +1,27 @@
 #include "contexted-poller.hpp"
 
+#include <algorithm>
+#include <string>
+
 #include "context.hpp"
-#include "message-identifier.hpp"
 
 namespace dory {
-PollingContext::PollingContext() {}
+PollingContext::PollingContext() : cc{nullptr}, context_kind{0}, from_nr{0} {
+  from.fill(nullptr);
+  to.fill(nullptr);
+}
 
-PollingContext::PollingContext(
-    ConnectionContext *cc, ContextKind context_kind,
-    std::vector<moodycamel::ReaderWriterQueue<WC> *> &from,
-    std::map<ContextKind, moodycamel::ReaderWriterQueue<WC> *> &to)
-    : cc{cc}, context_kind{context_kind}, from{from}, to{to} {}
+PollingContext::PollingContext(ConnectionContext *cc, ContextKind context_kind,
+                               std::array<CompletionRing *, Kinds> const &from,
+                               std::array<CompletionRing *, Kinds> const &to)
+    : cc{cc}, context_kind{context_kind}, from_nr{0}, to{to} {
+  this->from.fill(nullptr);
+  for (auto ring : from) {
+    if (ring != nullptr) {
+      this->from[from_nr++] = ring;
+    }
+  }
+}
 
 bool PollingContext::operator()(deleted_unique_ptr<struct ibv_cq> &,
                                 std::vector<struct ibv_wc> &entries) {
@@ -18,44 +29,38 @@ bool PollingContext::operator()(deleted_unique_ptr<struct ibv_cq> &,
   int index = 0;
 
   // Go over all the queues and try to fulfill the request
-  for (auto queue : from) {
-    WC returned;
-
-    while (num_requested > 0 && queue->try_dequeue(returned)) {
-      entries[index].wr_id = returned.wr_id;
-      entries[index].status = returned.status;
-      index += 1;
-      num_requested -= 1;
-    }
+  for (int i = 0; i < from_nr && index < num_requested; i++) {
+    index += from[i]->pop(&entries[index], num_requested - index);
+  }
 
-    if (num_requested == 0) {
-      return true;
-    }
+  if (index == num_requested) {
+    return true;
   }
 
-  // Poll the rest and distribute if necessary
+  // Poll the rest in one go and distribute the batch
   auto cq = cc->cq.get();
-  int num = ibv_poll_cq(cq, num_requested, &entries[index]);
+  int num = ibv_poll_cq(cq, num_requested - index, &entries[index]);
 
   if (num >= 0) {
-    int frozen_index = index;
+    int end = index + num;
     // The ones that are not ours, put them in their respective queues
-    for (int i = frozen_index; i < frozen_index + num; i++) {
+    for (int i = index; i < end; i++) {
       auto &entry = entries[i];
-      int kind = quorum::unpackKind(entry.wr_id);
+      auto kind = static_cast<int>(quorum::unpackKind(entry.wr_id));
 
       if (kind == context_kind) {
         entries[index] = entry;
         index++;
       } else {
-        auto queue = to.find(kind);
-        if (queue == to.end()) {
-          throw std::runtime_error("No queue exists with kind " + kind);
-        } else {
-          if (!queue->second->try_enqueue(WC{entry})) {
-            // throw std::runtime_error("Queue overflowed");
-            return false;
-          }
+        auto ring = to[kind];
+        if (ring == nullptr) {
+          throw std::runtime_error("No queue exists with kind " +
+                                   std::to_string(kind));
+        }
+
+        if (!ring->push(entry)) {
+          // throw std::runtime_error("Queue overflowed");
+          return false;
         }
       }
     }
@@ -71,6 +76,11 @@ namespace dory {
 ContextedPoller::ContextedPoller(ConnectionContext *cc) : cc{cc}, done{false} {}
 
 void ContextedPoller::registerContext(ContextKind context_kind) {
+  if (context_kind < 0 || context_kind >= Kinds) {
+    throw std::runtime_error("Polling contexts are quorum kinds, not " +
+                             std::to_string(context_kind));
+  }
+
   const std::lock_guard<std::mutex> lock(contexts_mutex);
   if (contexts.find(context_kind) != contexts.end()) {
     throw std::runtime_error("Already registered polling context with id " +
@@ -93,19 +103,17 @@ void ContextedPoller::endRegistrations(size_t expected_nr_contexts) {
     return;
   }
 
-  done.store(true);
-
   // Create all to all queues
   for (auto cid_from : contexts) {
     for (auto cid_to : contexts) {
       if (cid_from == cid_to) {
         continue;
       }
-      queues.insert(
-          std::make_pair(std::make_pair(cid_from, cid_to),
-                         moodycamel::ReaderWriterQueue<WC>(QueueDepth)));
+      rings[cid_from][cid_to] = std::make_unique<CompletionRing>(QueueDepth);
     }
   }
+
+  done.store(true);
 }
 
 PollingContext ContextedPoller::getContext(ContextKind context_kind) {
@@ -113,22 +121,19 @@ PollingContext ContextedPoller::getContext(ContextKind context_kind) {
     throw std::runtime_error("ContextedPoller is not finalized");
   }
 
-  std::map<ContextKind, moodycamel::ReaderWriterQueue<WC> *> to_mapping;
-  std::vector<moodycamel::ReaderWriterQueue<WC> *> from_list;
-  // Create a compact map
-  for (auto &[cid_from_to, queue] : queues) {
-    auto from = cid_from_to.first;
-    auto to = cid_from_to.second;
-    if (to == context_kind) {
-      from_list.push_back(&queue);
-    }
+  if (context_kind < 0 || context_kind >= Kinds) {
+    throw std::runtime_error("Polling contexts are quorum kinds, not " +
+                             std::to_string(context_kind));
+  }
 
-    if (from == context_kind) {
-      to_mapping.insert(std::make_pair(to, &queue));
-    }
+  std::array<CompletionRing *, Kinds> from_rings;
+  std::array<CompletionRing *, Kinds> to_rings;
+  for (int other = 0; other < Kinds; other++) {
+    from_rings[other] = rings[other][context_kind].get();
+    to_rings[other] = rings[context_kind][other].get();
   }
 
-  return PollingContext(cc, context_kind, from_list, to_mapping);
+  return PollingContext(cc, context_kind, from_rings, to_rings);
 }
 
-}  // namespace dory
\ No newline at end of file
+}  // namespace dory
@@ -1,12 +1,16 @@
 #pragma once
 
-#include <map>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <stdexcept>
 #include <vector>
 
 #include <dory/ctrl/block.hpp>
-#include "readerwriterqueue.h"
+#include "message-identifier.hpp"
 
 namespace dory {
 
@@ -25,12 +29,82 @@ struct WC {
   WC(struct ibv_wc &wc) : wr_id{wc.wr_id}, status{wc.status} {}
 };
 
+/*File SPSC de wc, d'un contexte qui les a trouvés dans la cq vers celui à qui
+ils appartiennent. Le producteur et le consommateur n'écrivent pas sur la même
+ligne de cache : chacun garde une copie de l'indice de l'autre et ne relit le
+vrai que quand la copie ne suffit plus.*/
+class CompletionRing {
+ public:
+  static constexpr size_t CacheLine = 64;
+
+  CompletionRing(size_t depth)
+      : head{0}, cached_tail{0}, tail{0}, cached_head{0}, mask{depth - 1},
+        slots(depth) {
+    if (depth == 0 || (depth & (depth - 1)) != 0) {
+      throw std::runtime_error("The depth of a CompletionRing must be a power "
+                               "of 2");
+    }
+  }
+
+  // Producer side
+  inline bool push(struct ibv_wc const &wc) {
+    auto t = tail.load(std::memory_order_relaxed);
+    if (t - cached_head > mask) {
+      cached_head = head.load(std::memory_order_acquire);
+      if (t - cached_head > mask) {
+        return false;
+      }
+    }
+
+    auto &slot = slots[t & mask];
+    slot.wr_id = wc.wr_id;
+    slot.status = wc.status;
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side: moves up to `max` wc to `out`, returns how many
+  inline int pop(struct ibv_wc *out, int max) {
+    auto h = head.load(std::memory_order_relaxed);
+    if (cached_tail == h) {
+      cached_tail = tail.load(std::memory_order_acquire);
+      if (cached_tail == h) {
+        return 0;
+      }
+    }
+
+    auto n = std::min(cached_tail - h, static_cast<size_t>(max));
+    for (size_t i = 0; i < n; i++) {
+      auto &slot = slots[(h + i) & mask];
+      out[i].wr_id = slot.wr_id;
+      out[i].status = slot.status;
+    }
+    head.store(h + n, std::memory_order_release);
+    return static_cast<int>(n);
+  }
+
+ private:
+  alignas(CacheLine) std::atomic<size_t> head;
+  size_t cached_tail;
+
+  alignas(CacheLine) std::atomic<size_t> tail;
+  size_t cached_head;
+
+  alignas(CacheLine) size_t const mask;
+  std::vector<WC> slots;
+};
+
+/*Vue d'un contexte sur le ContextedPoller : les files qui lui arrivent, et
+celle de chaque kind vers qui il renvoie ce qui n'est pas à lui. Tout est dans
+des tableaux indexés par quorum::Kind, copier le contexte ne copie que des
+pointeurs.*/
 struct PollingContext : public GenericContext {
+  static constexpr int Kinds = quorum::MAX + 1;
+
   PollingContext();
-  PollingContext(
-      ConnectionContext *cc, ContextKind context_kind,
-      std::vector<moodycamel::ReaderWriterQueue<WC> *> &from,
-      std::map<ContextKind, moodycamel::ReaderWriterQueue<WC> *> &to);
+  PollingContext(ConnectionContext *cc, ContextKind context_kind,
+                 std::array<CompletionRing *, Kinds> const &from,
+                 std::array<CompletionRing *, Kinds> const &to);
 
   bool operator()(deleted_unique_ptr<struct ibv_cq> &,
                   std::vector<struct ibv_wc> &entries);
@@ -38,8 +112,9 @@ struct PollingContext : public GenericContext {
  private:
   ConnectionContext *cc;
   ContextKind context_kind;
-  std::vector<moodycamel::ReaderWriterQueue<WC> *> from;
-  std::map<ContextKind, moodycamel::ReaderWriterQueue<WC> *> to;
+  std::array<CompletionRing *, Kinds> from;  // Compact, `from_nr` first ones
+  int from_nr;
+  std::array<CompletionRing *, Kinds> to;  // By kind, nullptr if unregistered
 };
 
 class ContextedPoller : public GenericContext {
@@ -53,8 +128,11 @@ class ContextedPoller : public GenericContext {
   PollingContext getContext(ContextKind context_kind);
 
  private:
+  static constexpr int Kinds = PollingContext::Kinds;
+
   ConnectionContext *cc;
-  std::map<std::pair<ContextKind, ContextKind>,  moodycamel::ReaderWriterQueue<WC>> queues;  // (from, to) -> queue
+  // [from][to], only between registered contexts
+  std::array<std::array<std::unique_ptr<CompletionRing>, Kinds>, Kinds> rings;
   std::set<ContextKind> contexts;
   std::mutex contexts_mutex;
   std::atomic<bool> done;
@@ -62,4 +140,4 @@ class ContextedPoller : public GenericContext {
   static constexpr int QueueDepth = 1024;
 };
 
-}  // namespace dory
\ No newline at end of file
+}  // namespace dory
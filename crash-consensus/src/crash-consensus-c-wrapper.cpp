@@ -1,5 +1,8 @@
+#include <stdexcept>
+
 #include "consensus.hpp"
 #include "crash-consensus.h"
+#include "crash-consensus.hpp"
 
 /*Utilisé pour faire l'interface avec memcached et redis (codés en C)
 
@@ -15,18 +18,90 @@ Par exemple, voilà comment c'est utilisé dans redis :
     
 Avec les mains : 
   Lors de l'initialisation, on initialise notre consensus, et on lui attache la fonction commiter 
-  Ensuite on lance la thread : elle attend qu'on lui signale qu'il faut faire un propose. Quand c'est le cas, elle propose. 
-  Pour le lui signaler, on appelle consensus_propose_thread() 
+  Ensuite on lance la thread : elle vide la SubmissionRing dans l'ordre et propose les commandes, 
+  en regroupant dans une même entrée celles qui arrivent ensemble (group commit). 
+  Pour lui soumettre une commande, on appelle consensus_propose_thread(), depuis autant de threads que l'on veut 
+  (chaque appel attend le résultat de sa propre commande)
 
 */
 
 consensus_t new_consensus(int my_id, int *remote_ids, int remote_ids_num) {
+  ConsensusOptions options;
+  consensus_default_options(&options);
+  options.my_id = my_id;
+  options.remote_ids = remote_ids;
+  options.remote_ids_num = remote_ids_num;
+
+  return new_consensus_with_options(&options);
+}
+
+void consensus_default_options(ConsensusOptions *options) {
+  dory::ConsensusOptions defaults;
+
+  options->my_id = 0;
+  options->remote_ids = nullptr;
+  options->remote_ids_num = 0;
+  options->outstanding_req = defaults.outstanding_req;
+  options->log_size = defaults.log_size;
+  options->pages = ConsensusRegularPages;
+  options->snapshot_size = defaults.snapshot_size;
+  options->log_path = nullptr;
+  options->flush_policy = ConsensusFlushPerBatch;
+  options->index_log = defaults.index_log;
+  options->populate_threads = defaults.populate_threads;
+  options->send_queue_depth = defaults.send_queue_depth;
+  options->completion_queue_depth = defaults.completion_queue_depth;
+}
+
+consensus_t new_consensus_with_options(const ConsensusOptions *options) {
   std::vector<int> rem_ids;
-  for (int i = 0; i < remote_ids_num; i++) {
-    rem_ids.push_back(remote_ids[i]);
+  for (int i = 0; i < options->remote_ids_num; i++) {
+    rem_ids.push_back(options->remote_ids[i]);
+  }
+
+  dory::ConsensusOptions opts;
+  opts.outstanding_req = options->outstanding_req;
+  opts.log_size = options->log_size;
+  opts.snapshot_size = options->snapshot_size;
+  opts.log_path = options->log_path != nullptr ? options->log_path : "";
+  opts.index_log = options->index_log;
+  opts.populate_threads = options->populate_threads;
+  opts.send_queue_depth = options->send_queue_depth;
+  opts.completion_queue_depth = options->completion_queue_depth;
+
+  switch (options->pages) {
+    case ConsensusRegularPages:
+      opts.huge_pages = dory::HugePages::None;
+      break;
+    case ConsensusHugePages2MiB:
+      opts.huge_pages = dory::HugePages::Huge2MiB;
+      break;
+    case ConsensusHugePages1GiB:
+      opts.huge_pages = dory::HugePages::Huge1GiB;
+      break;
+    default:
+      throw std::runtime_error("Unknown page size");
+  }
+
+  switch (options->flush_policy) {
+    case ConsensusFlushNone:
+      opts.flush_policy = dory::FlushPolicy::None;
+      break;
+    case ConsensusFlushPerEntry:
+      opts.flush_policy = dory::FlushPolicy::PerEntry;
+      break;
+    case ConsensusFlushPerBatch:
+      opts.flush_policy = dory::FlushPolicy::PerBatch;
+      break;
+    case ConsensusFlushAsync:
+      opts.flush_policy = dory::FlushPolicy::Async;
+      break;
+    default:
+      throw std::runtime_error("Unknown flush policy");
   }
 
-  return reinterpret_cast<void *>(new dory::RdmaConsensus(my_id, rem_ids));
+  return reinterpret_cast<void *>(
+      dory::newRdmaConsensus(options->my_id, rem_ids, opts));
 }
 
 void free_consensus(consensus_t c) {
@@ -43,29 +118,113 @@ void consensus_attach_commit_handler(consensus_t c, committer_t f,
       });
 }
 
+void consensus_attach_commit_batch_handler(consensus_t c, batch_committer_t f,
+                                           void *committer_ctx) {
+  auto cons = reinterpret_cast<dory::RdmaConsensus *>(c);
+  cons->commitBatchHandler(
+      [f, committer_ctx, bufs = std::vector<uint8_t *>(),
+       lens = std::vector<size_t>()](
+          bool leader, dory::Committer::Record const *records,
+          size_t num) mutable {
+        bufs.resize(num);
+        lens.resize(num);
+        for (size_t i = 0; i < num; i++) {
+          bufs[i] = records[i].first;
+          lens[i] = records[i].second;
+        }
+        f(leader, bufs.data(), lens.data(), num, committer_ctx);
+      });
+}
+
+void consensus_apply_in_background(consensus_t c) {
+  reinterpret_cast<dory::RdmaConsensus *>(c)->applyInBackground();
+}
+
+uint64_t consensus_committed_index(consensus_t c) {
+  return reinterpret_cast<dory::RdmaConsensus *>(c)->committedIndex();
+}
+
+void consensus_wait_applied(consensus_t c, uint64_t index) {
+  reinterpret_cast<dory::RdmaConsensus *>(c)->waitApplied(index);
+}
+
 void consensus_spawn_thread(consensus_t c) {
+  reinterpret_cast<dory::RdmaConsensus *>(c)->spawnHandover();
+}
+
+void consensus_group_commit_stats(consensus_t c, uint64_t *entries,
+                                  uint64_t *commands, uint64_t *max_batch) {
+  auto stats = reinterpret_cast<dory::RdmaConsensus *>(c)->groupCommitStats();
+  *entries = stats.entries;
+  *commands = stats.commands;
+  *max_batch = stats.max_batch;
+}
+
+bool consensus_can_serve_local_read(consensus_t c) {
+  return reinterpret_cast<dory::RdmaConsensus *>(c)->canServeLocalRead();
+}
+
+ConsensusProposeError consensus_read_barrier(consensus_t c) {
+  return static_cast<ConsensusProposeError>(
+      reinterpret_cast<dory::RdmaConsensus *>(c)->readBarrier());
+}
+
+void consensus_replica_progress(consensus_t c, uint64_t *applied_fuo,
+                                uint64_t *applied_entries,
+                                uint64_t *pending_entries,
+                                uint64_t *staleness_us) {
+  auto p = reinterpret_cast<dory::RdmaConsensus *>(c)->replicaProgress();
+  *applied_fuo = p.applied_fuo;
+  *applied_entries = p.applied_entries;
+  *pending_entries = p.pending_entries;
+  *staleness_us = p.staleness_ns / 1000;
+}
+
+bool consensus_can_serve_stale_read(consensus_t c, uint64_t max_lag_entries,
+                                    uint64_t max_lag_us) {
+  return reinterpret_cast<dory::RdmaConsensus *>(c)->canServeStaleRead(
+      max_lag_entries, max_lag_us);
+}
+
+void consensus_attach_snapshot_handlers(consensus_t c, snapshotter_t s,
+                                        restorer_t r, void *snapshot_ctx) {
   auto cons = reinterpret_cast<dory::RdmaConsensus *>(c);
-  cons->handover.store(false);
-  cons->handover_thd = std::thread([cons]() {
-    while (true) {
-      while (cons->handover.load() == false) {
-      }
+  cons->snapshotHandlers(
+      [s, snapshot_ctx](uint8_t *buf, size_t capacity) {
+        return s(buf, capacity, snapshot_ctx);
+      },
+      [r, snapshot_ctx](uint8_t const *buf, size_t len) {
+        r(buf, len, snapshot_ctx);
+      });
+}
 
-      cons->handover_ret = cons->propose(cons->handover_buf, cons->handover_buf_len);
+ConsensusProposeError consensus_take_snapshot(consensus_t c) {
+  return static_cast<ConsensusProposeError>(
+      reinterpret_cast<dory::RdmaConsensus *>(c)->takeSnapshot());
+}
 
-      cons->handover.store(false);
-    }
-  });
+ConsensusProposeError consensus_install_snapshot(consensus_t c, int from_id) {
+  return static_cast<ConsensusProposeError>(
+      reinterpret_cast<dory::RdmaConsensus *>(c)->installSnapshot(from_id));
+}
 
-  if (cons->threadConfig.pinThreads) {
-    dory::pinThreadToCore(cons->handover_thd,
-                          cons->threadConfig.handoverThreadCoreID);
-  }
+ConsensusProposeError consensus_export_log(consensus_t c, int fd,
+                                           uint64_t *seq) {
+  return static_cast<ConsensusProposeError>(
+      reinterpret_cast<dory::RdmaConsensus *>(c)->exportLog(fd, *seq));
+}
 
-  if (dory::ConsensusConfig::nameThreads) {
-    dory::setThreadName(cons->handover_thd,
-                        dory::ConsensusConfig::handoverThreadName);
-  }
+ConsensusProposeError consensus_import_log(consensus_t c, int fd) {
+  return static_cast<ConsensusProposeError>(
+      reinterpret_cast<dory::RdmaConsensus *>(c)->importLog(fd));
+}
+
+void consensus_flush_stats(consensus_t c, uint64_t *entries, uint64_t *flushes,
+                           uint64_t *ns) {
+  auto stats = reinterpret_cast<dory::RdmaConsensus *>(c)->flushStats();
+  *entries = stats.entries;
+  *flushes = stats.flushes;
+  *ns = stats.ns;
 }
 
 int consensus_potential_leader(consensus_t c) {
@@ -76,14 +235,73 @@ ConsensusProposeError consensus_propose(consensus_t c, uint8_t *buf, size_t len)
   return static_cast<ConsensusProposeError>( reinterpret_cast<dory::RdmaConsensus *>(c)->propose(buf, len));
 }
 
-ConsensusProposeError consensus_propose_thread(consensus_t c, uint8_t *buf,
-                                               size_t len) {
+ConsensusProposeError consensus_propose_iov(consensus_t c,
+                                            const struct iovec *iov,
+                                            int iovcnt) {
+  return static_cast<ConsensusProposeError>(
+      reinterpret_cast<dory::RdmaConsensus *>(c)->propose(iov, iovcnt));
+}
+
+void consensus_register_memory(consensus_t c, void *addr, size_t len) {
+  reinterpret_cast<dory::RdmaConsensus *>(c)->registerMemory(addr, len);
+}
+
+ConsensusProposeError consensus_propose_batch(consensus_t c, uint8_t **bufs,
+                                              size_t *lens, size_t num) {
+  std::vector<std::pair<uint8_t *, size_t>> cmds;
+  cmds.reserve(num);
+  for (size_t i = 0; i < num; i++) {
+    cmds.push_back(std::make_pair(bufs[i], lens[i]));
+  }
+
+  return static_cast<ConsensusProposeError>(
+      reinterpret_cast<dory::RdmaConsensus *>(c)->proposeBatch(cmds));
+}
+
+ConsensusProposeError consensus_propose_async(consensus_t c, uint8_t *buf,
+                                              size_t len, uint64_t *ticket) {
+  return static_cast<ConsensusProposeError>(
+      reinterpret_cast<dory::RdmaConsensus *>(c)->proposeAsync(buf, len,
+                                                               *ticket));
+}
+
+void consensus_attach_completion_handler(consensus_t c, completer_t f,
+                                         void *completer_ctx) {
   auto cons = reinterpret_cast<dory::RdmaConsensus *>(c);
-  cons->handover_buf = buf;
-  cons->handover_buf_len = len;
-  cons->handover.store(true);
-  while (cons->handover.load() == true) {
+  cons->completionHandler([f, completer_ctx](uint64_t ticket, bool committed) {
+    f(ticket, committed, completer_ctx);
+  });
+}
+
+int consensus_poll(consensus_t c) {
+  return reinterpret_cast<dory::RdmaConsensus *>(c)->poll();
+}
+
+bool consensus_wait(consensus_t c, uint64_t ticket) {
+  return reinterpret_cast<dory::RdmaConsensus *>(c)->wait(ticket);
+}
+
+ConsensusProposeError consensus_reserve(consensus_t c, size_t len,
+                                        uint8_t **buf, uint64_t *handle) {
+  dory::RdmaConsensus::Reservation r;
+  auto ret = reinterpret_cast<dory::RdmaConsensus *>(c)->reserve(len, r);
+  if (ret == 0) {
+    *buf = r.buf;
+    *handle = r.id;
   }
 
-  return static_cast<ConsensusProposeError>(cons->handover_ret);
+  return static_cast<ConsensusProposeError>(ret);
+}
+
+ConsensusProposeError consensus_commit_reserved(consensus_t c, uint64_t handle,
+                                                size_t used_len) {
+  dory::RdmaConsensus::Reservation r{nullptr, used_len, handle};
+  return static_cast<ConsensusProposeError>(
+      reinterpret_cast<dory::RdmaConsensus *>(c)->commitReserved(r));
+}
+
+ConsensusProposeError consensus_propose_thread(consensus_t c, uint8_t *buf,
+                                               size_t len) {
+  auto cons = reinterpret_cast<dory::RdmaConsensus *>(c);
+  return static_cast<ConsensusProposeError>(cons->submit(buf, len));
 }
\ No newline at end of file
@@ -4,15 +4,55 @@
 #include "crash-consensus.hpp"
 
 namespace dory {
-Consensus::Consensus(int my_id, std::vector<int> &remote_ids,
-                     int outstanding_req, bool want_tofino,  ThreadBank threadBank) {
+/*Le seul endroit où les options publiques (C++ et C, voir
+new_consensus_with_options) deviennent la configuration de RdmaConsensus.*/
+RdmaConsensus *newRdmaConsensus(int my_id, std::vector<int> &remote_ids,
+                                ConsensusOptions const &options) {
   ConsensusConfig::ThreadConfig config;
-  switch (threadBank) {
+
+  ConsensusConfig::MemoryConfig memory;
+  memory.logSize = options.log_size;
+  memory.snapshotSize = options.snapshot_size;
+  memory.logPath = options.log_path;
+  memory.indexLog = options.index_log;
+  memory.populateThreads = options.populate_threads;
+  memory.sendQueueDepth = options.send_queue_depth;
+  memory.completionQueueDepth = options.completion_queue_depth;
+
+  switch (options.flush_policy) {
+    case FlushPolicy::None:
+      memory.flushPolicy = ConsensusConfig::FlushPolicy::None;
+      break;
+    case FlushPolicy::PerEntry:
+      memory.flushPolicy = ConsensusConfig::FlushPolicy::PerEntry;
+      break;
+    case FlushPolicy::PerBatch:
+      memory.flushPolicy = ConsensusConfig::FlushPolicy::PerBatch;
+      break;
+    case FlushPolicy::Async:
+      memory.flushPolicy = ConsensusConfig::FlushPolicy::Async;
+      break;
+    default:
+      throw std::runtime_error("Unreachable, software bug");
+  }
+
+  switch (options.huge_pages) {
+    case HugePages::None:
+      memory.hugePages = ConsensusConfig::HugePages::None;
+      break;
+    case HugePages::Huge2MiB:
+      memory.hugePages = ConsensusConfig::HugePages::Huge2MiB;
+      break;
+    case HugePages::Huge1GiB:
+      memory.hugePages = ConsensusConfig::HugePages::Huge1GiB;
+      break;
+    default:
+      throw std::runtime_error("Unreachable, software bug");
+  }
+
+  switch (options.thread_bank) {
     case ThreadBank::A:
       std::cout << "RdmaConsensus object created with default ThreadBank settings (A)" << std::endl;
-      
-      std:: cout << "RDMACONSENSUS with want_tofino = " << want_tofino << std::endl;
-      impl = std::make_unique<RdmaConsensus>(my_id, remote_ids, outstanding_req, want_tofino);
       break;
     case ThreadBank::B:
       std::cout << "RdmaConsensus object created with ThreadBank settings" << std::endl;
@@ -21,14 +61,34 @@ Consensus::Consensus(int my_id, std::vector<int> &remote_ids,
       config.heartbeatThreadCoreID = ConsensusConfig::heartbeatThreadBankB_ID;
       config.followerThreadCoreID = ConsensusConfig::followerThreadBankB_ID;
       config.prefix = "Secondary-";
-      std:: cout << "RDMACONSENSUS with want_tofino = " << want_tofino << std::endl;
-      impl = std::make_unique<RdmaConsensus>(my_id, remote_ids, outstanding_req, want_tofino, config);
       break;
     default:
       throw std::runtime_error("Unreachable, software bug");
   }
+
+  std:: cout << "RDMACONSENSUS with want_tofino = " << options.want_tofino << std::endl;
+  return new RdmaConsensus(my_id, remote_ids, options.outstanding_req,
+                           options.want_tofino, config, memory);
+}
+
+static ConsensusOptions options_of(int outstanding_req, bool want_tofino,
+                                   ThreadBank threadBank) {
+  ConsensusOptions options;
+  options.outstanding_req = outstanding_req;
+  options.want_tofino = want_tofino;
+  options.thread_bank = threadBank;
+  return options;
 }
 
+Consensus::Consensus(int my_id, std::vector<int> &remote_ids,
+                     int outstanding_req, bool want_tofino,  ThreadBank threadBank)
+    : Consensus(my_id, remote_ids,
+                options_of(outstanding_req, want_tofino, threadBank)) {}
+
+Consensus::Consensus(int my_id, std::vector<int> &remote_ids,
+                     ConsensusOptions const &options)
+    : impl{newRdmaConsensus(my_id, remote_ids, options)} {}
+
 Consensus::~Consensus() {}
 
 /*commitHandler prend en argument une fonction (a callable object, of type std::function), qui return void et prend 3 paramètres : 
@@ -38,12 +98,146 @@ void Consensus::commitHandler( std::function<void(bool leader, uint8_t *buf, siz
   impl->commitHandler(committer);
 }
 
+void Consensus::commitBatchHandler(
+    std::function<void(bool leader, std::pair<uint8_t *, size_t> const *cmds,
+                       size_t num)>
+        committer) {
+  impl->commitBatchHandler(committer);
+}
+
+void Consensus::applyInBackground() { impl->applyInBackground(); }
+uint64_t Consensus::committedIndex() { return impl->committedIndex(); }
+void Consensus::waitApplied(uint64_t index) { impl->waitApplied(index); }
+
 /*wrapper autour du propose() de RdmaConsensus*/
 ProposeError Consensus::propose(uint8_t *buf, size_t len) {
   int ret = impl->propose(buf, len);
   return static_cast<ProposeError>(ret);
 }
 
+ProposeError Consensus::propose(struct iovec const *iov, int iovcnt) {
+  int ret = impl->propose(iov, iovcnt);
+  return static_cast<ProposeError>(ret);
+}
+
+void Consensus::registerMemory(void *addr, size_t len) {
+  impl->registerMemory(addr, len);
+}
+
+ProposeError Consensus::proposeBatch(
+    std::vector<std::pair<uint8_t *, size_t>> &cmds) {
+  int ret = impl->proposeBatch(cmds);
+  return static_cast<ProposeError>(ret);
+}
+
+ProposeError Consensus::proposeAsync(uint8_t *buf, size_t len,
+                                     uint64_t &ticket) {
+  int ret = impl->proposeAsync(buf, len, ticket);
+  return static_cast<ProposeError>(ret);
+}
+
+void Consensus::completionHandler(
+    std::function<void(uint64_t ticket, bool committed)> completer) {
+  impl->completionHandler(completer);
+}
+
+int Consensus::poll() { return impl->poll(); }
+bool Consensus::wait(uint64_t ticket) { return impl->wait(ticket); }
+
+ProposeError Consensus::reserve(size_t len, Reservation &r) {
+  RdmaConsensus::Reservation res;
+  int ret = impl->reserve(len, res);
+  if (ret == 0) {
+    r.buf = res.buf;
+    r.len = res.len;
+    r.id = res.id;
+  }
+  return static_cast<ProposeError>(ret);
+}
+
+ProposeError Consensus::commitReserved(Reservation const &r) {
+  RdmaConsensus::Reservation res{r.buf, r.len, r.id};
+  int ret = impl->commitReserved(res);
+  return static_cast<ProposeError>(ret);
+}
+
+void Consensus::spawnHandover() { impl->spawnHandover(); }
+
+ProposeError Consensus::submit(uint8_t *buf, size_t len) {
+  int ret = impl->submit(buf, len);
+  return static_cast<ProposeError>(ret);
+}
+
+GroupCommitStats Consensus::groupCommitStats() {
+  auto stats = impl->groupCommitStats();
+
+  GroupCommitStats s;
+  s.entries = stats.entries;
+  s.commands = stats.commands;
+  s.max_batch = stats.max_batch;
+  return s;
+}
+
+bool Consensus::canServeLocalRead() { return impl->canServeLocalRead(); }
+
+ProposeError Consensus::readBarrier() {
+  int ret = impl->readBarrier();
+  return static_cast<ProposeError>(ret);
+}
+
+ReplicaProgress Consensus::replicaProgress() {
+  auto snapshot = impl->replicaProgress();
+
+  ReplicaProgress p;
+  p.applied_fuo = snapshot.applied_fuo;
+  p.applied_entries = snapshot.applied_entries;
+  p.pending_entries = snapshot.pending_entries;
+  p.staleness_us = snapshot.staleness_ns / 1000;
+  return p;
+}
+
+bool Consensus::canServeStaleRead(uint64_t max_lag_entries,
+                                  uint64_t max_lag_us) {
+  return impl->canServeStaleRead(max_lag_entries, max_lag_us);
+}
+
+void Consensus::snapshotHandlers(
+    std::function<size_t(uint8_t *buf, size_t capacity)> snapshot,
+    std::function<void(uint8_t const *buf, size_t len)> restore) {
+  impl->snapshotHandlers(snapshot, restore);
+}
+
+ProposeError Consensus::takeSnapshot() {
+  int ret = impl->takeSnapshot();
+  return static_cast<ProposeError>(ret);
+}
+
+ProposeError Consensus::installSnapshot(int from_id) {
+  int ret = impl->installSnapshot(from_id);
+  return static_cast<ProposeError>(ret);
+}
+
+FlushStats Consensus::flushStats() {
+  auto stats = impl->flushStats();
+
+  FlushStats s;
+  s.entries = stats.entries;
+  s.flushes = stats.flushes;
+  s.bytes = stats.bytes;
+  s.ns = stats.ns;
+  return s;
+}
+
+ProposeError Consensus::exportLog(int fd, uint64_t &seq) {
+  int ret = impl->exportLog(fd, seq);
+  return static_cast<ProposeError>(ret);
+}
+
+ProposeError Consensus::importLog(int fd) {
+  int ret = impl->importLog(fd);
+  return static_cast<ProposeError>(ret);
+}
+
 int Consensus::potentialLeader() { return impl->potentialLeader(); }
 bool Consensus::blockedResponse() { return impl->response_blocked->load(); }
 
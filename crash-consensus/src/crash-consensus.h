@@ -1,5 +1,7 @@
 #pragma once
 
+#include <sys/uio.h>
+
 #ifdef __cplusplus
 #include <cstdint>
 #include <cstddef>
@@ -14,7 +16,7 @@ typedef enum {
   ProposalNoError = 0,  // Placeholder for the 0 value
   ProposalMutexUnavailable,
   ProposalFastPath,
-  ProposalFastPathRecyclingTriggered,
+  ProposalFastPathRecyclingTriggered,  // Not returned anymore (ring log)
   ProposalSlowPathCatchFUO,
   ProposalSlowPathUpdateFollowers,
   ProposalSlowPathCatchProposal,
@@ -23,19 +25,98 @@ typedef enum {
   ProposalSlowPathWriteAdoptedValue,
   ProposalSlowPathWriteNewValue,
   ProposalFollowerMode,
-  ProposalSlowPathLogRecycled
+  ProposalSlowPathLogRecycled,  // Not returned anymore (ring log)
+  ProposalReservationInvalid,
+  ProposalLeaseUnavailable,
+  ProposalSnapshotUnavailable,
+  ProposalStreamUnavailable,
+  // Every replica, not just a majority, must answer the recycling of the log
+  // before the leader enters the next segment. Returned (right away after
+  // the first timeout) while one of them does not.
+  ProposalRecyclingUnanswered,
+  ProposalFlushUnconfirmed  // A majority did not flush the entry in time
 } ConsensusProposeError;
 
+typedef enum {
+  ConsensusRegularPages = 0,
+  ConsensusHugePages2MiB,
+  ConsensusHugePages1GiB
+} ConsensusPageSize;
+
+typedef enum {
+  ConsensusFlushNone = 0,
+  ConsensusFlushPerEntry,
+  ConsensusFlushPerBatch,
+  ConsensusFlushAsync
+} ConsensusFlushPolicy;
+
 // C Interface.
 typedef void *consensus_t;
 typedef void (*committer_t)(bool leader, uint8_t *buf, size_t len, void *ctx);
+typedef void (*batch_committer_t)(bool leader, uint8_t **bufs, size_t *lens,
+                                  size_t num, void *ctx);
+typedef void (*completer_t)(uint64_t ticket, bool committed, void *ctx);
+typedef size_t (*snapshotter_t)(uint8_t *buf, size_t capacity, void *ctx);
+typedef void (*restorer_t)(uint8_t const *buf, size_t len, void *ctx);
 
 // Need an explicit constructor and destructor.
 consensus_t new_consensus(int my_id, int *remote_ids, int remote_ids_num);
+
+// Everything new_consensus_with_options can set. consensus_default_options
+// fills in the defaults of new_consensus (a volatile log of 2GiB), the ids of
+// the replicas are left to the caller.
+typedef struct {
+  int my_id;
+  int *remote_ids;
+  int remote_ids_num;
+
+  int outstanding_req;  // Proposals in flight before consensus_propose blocks
+
+  // Registered memory for the log and the scratchpad, optionally backed by
+  // huge pages
+  size_t log_size;
+  ConsensusPageSize pages;
+
+  // Part of it set aside for the snapshots of the application (the same on
+  // every replica), 0 disables snapshots
+  size_t snapshot_size;
+
+  // NULL for a volatile log. Otherwise the registered memory is the file (or
+  // DAX device) at `log_path`, so that the log survives a restart, flushed
+  // according to `flush_policy`.
+  const char *log_path;
+  ConsensusFlushPolicy flush_policy;
+
+  // Index of the entries of the current lap by sequence number
+  bool index_log;
+
+  // Threads pre-faulting the registered memory, 0 leaves it to ibv_reg_mr
+  int populate_threads;
+
+  // Depth of the replication send queues and of their completion queue, 0
+  // sizes them from outstanding_req (within the limits of the device)
+  int send_queue_depth;
+  int completion_queue_depth;
+} ConsensusOptions;
+
+void consensus_default_options(ConsensusOptions *options);
+consensus_t new_consensus_with_options(const ConsensusOptions *options);
 void free_consensus(consensus_t c);
 
 void consensus_attach_commit_handler(consensus_t c, committer_t f, void *committer_ctx);
 
+// Alternative to consensus_attach_commit_handler: all the commands committed
+// together are delivered in a single call
+void consensus_attach_commit_batch_handler(consensus_t c, batch_committer_t f,
+                                           void *committer_ctx);
+
+// Opt-in, before attaching a commit handler: commands are applied from a
+// dedicated thread. consensus_wait_applied(c, consensus_committed_index(c))
+// waits until everything committed so far is applied.
+void consensus_apply_in_background(consensus_t c);
+uint64_t consensus_committed_index(consensus_t c);
+void consensus_wait_applied(consensus_t c, uint64_t index);
+
 void consensus_spawn_thread(consensus_t c);
 
 ConsensusProposeError consensus_propose_thread(consensus_t c, uint8_t *buf,
@@ -43,6 +124,76 @@ ConsensusProposeError consensus_propose_thread(consensus_t c, uint8_t *buf,
 
 ConsensusProposeError consensus_propose(consensus_t c, uint8_t *buf,
                                         size_t len);
+
+// Proposes the concatenation of the `iovcnt` buffers as one command. Buffers
+// inside memory given to consensus_register_memory are sent without a copy,
+// the call then returns once every replica (not just a majority) has the
+// entry, so that the buffers can be reused.
+ConsensusProposeError consensus_propose_iov(consensus_t c,
+                                            const struct iovec *iov,
+                                            int iovcnt);
+void consensus_register_memory(consensus_t c, void *addr, size_t len);
+
+// Replicates the `num` commands (bufs[i], lens[i]) in a single log entry.
+ConsensusProposeError consensus_propose_batch(consensus_t c, uint8_t **bufs,
+                                              size_t *lens, size_t num);
+
+// Returns as soon as the command is posted, the outcome is delivered through
+// consensus_poll/consensus_wait and the completion handler.
+ConsensusProposeError consensus_propose_async(consensus_t c, uint8_t *buf,
+                                              size_t len, uint64_t *ticket);
+void consensus_attach_completion_handler(consensus_t c, completer_t f,
+                                         void *completer_ctx);
+int consensus_poll(consensus_t c);
+bool consensus_wait(consensus_t c, uint64_t ticket);
+
+// Zero-copy propose: *buf points inside the log, where the command of at most
+// `len` bytes must be serialized before committing `used_len` of them.
+ConsensusProposeError consensus_reserve(consensus_t c, size_t len,
+                                        uint8_t **buf, uint64_t *handle);
+ConsensusProposeError consensus_commit_reserved(consensus_t c, uint64_t handle,
+                                                size_t used_len);
+
+// Achieved group commit: entries proposed by the handover thread and the
+// commands they contained (their ratio is the average batch size)
+void consensus_group_commit_stats(consensus_t c, uint64_t *entries,
+                                  uint64_t *commands, uint64_t *max_batch);
+
+// Leader read lease: while consensus_can_serve_local_read is true, reads can
+// be answered from the local state. consensus_read_barrier renews the lease
+// if needed (call it from the proposing thread).
+bool consensus_can_serve_local_read(consensus_t c);
+ConsensusProposeError consensus_read_barrier(consensus_t c);
+
+// Bounded-staleness reads on any replica: how far the replica has committed,
+// and whether its state lags by at most `max_lag_entries` log entries and
+// `max_lag_us` microseconds
+void consensus_replica_progress(consensus_t c, uint64_t *applied_fuo,
+                                uint64_t *applied_entries,
+                                uint64_t *pending_entries,
+                                uint64_t *staleness_us);
+bool consensus_can_serve_stale_read(consensus_t c, uint64_t max_lag_entries,
+                                    uint64_t max_lag_us);
+
+// Snapshots: `s` serializes the state in at most `capacity` bytes and returns
+// its length, `r` replaces the state. consensus_take_snapshot covers all that
+// is committed, consensus_install_snapshot restores the snapshot of `from_id`
+// on a follower that lost its state.
+void consensus_attach_snapshot_handlers(consensus_t c, snapshotter_t s,
+                                        restorer_t r, void *snapshot_ctx);
+ConsensusProposeError consensus_take_snapshot(consensus_t c);
+ConsensusProposeError consensus_install_snapshot(consensus_t c, int from_id);
+
+// Streams the committed entries from sequence number `*seq` to `fd` and moves
+// `*seq` past them, consensus_import_log replays such a stream on a follower
+ConsensusProposeError consensus_export_log(consensus_t c, int fd,
+                                           uint64_t *seq);
+ConsensusProposeError consensus_import_log(consensus_t c, int fd);
+
+// Cost of keeping the log durable, ns / entries is the cost per entry
+void consensus_flush_stats(consensus_t c, uint64_t *entries, uint64_t *flushes,
+                           uint64_t *ns);
+
 int consensus_potential_leader(consensus_t c);
 
 #ifdef __cplusplus
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <sys/uio.h>
+
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -12,7 +16,7 @@ enum class ProposeError {
   NoError = 0,  // Placeholder for the 0 value
   MutexUnavailable,
   FastPath,
-  FastPathRecyclingTriggered,
+  FastPathRecyclingTriggered,  // Not returned anymore (ring log)
   SlowPathCatchFUO,
   SlowPathUpdateFollowers,
   SlowPathCatchProposal,
@@ -21,23 +25,191 @@ enum class ProposeError {
   SlowPathWriteAdoptedValue,
   SlowPathWriteNewValue,
   FollowerMode,
-  SlowPathLogRecycled
+  SlowPathLogRecycled,  // Not returned anymore (ring log)
+  ReservationInvalid,
+  LeaseUnavailable,
+  SnapshotUnavailable,
+  StreamUnavailable,
+  // Every replica, not just a majority, must answer the recycling of the log
+  // before the leader enters the next segment. Returned (right away after
+  // the first timeout) while one of them does not.
+  RecyclingUnanswered,
+  FlushUnconfirmed  // A majority did not flush the entry in time
 };
 
 enum class ThreadBank { A, B };
 
+// Pages backing the registered memory (log and scratchpad). Falls back to
+// regular pages if the system has no huge pages to spare.
+enum class HugePages { None, Huge2MiB, Huge1GiB };
+
+// Size of the registered memory, shared by the log and the scratchpad
+static constexpr size_t DefaultLogSize = 2UL * 1024 * 1024 * 1024;
+
+// When the entries of a durable log are flushed: as each one lands in the
+// local log, once per commit round, or by a background thread. With PerEntry
+// and PerBatch a proposal is reported committed once a majority of the
+// replicas flushed it, with Async once it is replicated (it may be durable
+// nowhere yet).
+enum class FlushPolicy { None, PerEntry, PerBatch, Async };
+
+// Cost of keeping the log durable, ns / entries is the cost per entry
+struct FlushStats {
+  uint64_t entries = 0;
+  uint64_t flushes = 0;
+  uint64_t bytes = 0;
+  uint64_t ns = 0;
+};
+
+// Achieved batching of the group commit, commands / entries is the average
+// batch size
+struct GroupCommitStats {
+  uint64_t entries = 0;
+  uint64_t commands = 0;
+  uint64_t max_batch = 0;
+};
+
+// How far a replica has committed (see Consensus::replicaProgress)
+struct ReplicaProgress {
+  uint64_t applied_fuo = 0;      // Offset in the log
+  uint64_t applied_entries = 0;  // Log entries committed locally, monotonic
+  uint64_t pending_entries = 0;  // Received, not known to be committed yet
+  uint64_t staleness_us = 0;     // Age of the last state known to be complete
+};
+
+// Everything a Consensus can be created with, the defaults give a volatile
+// log of DefaultLogSize bytes
+struct ConsensusOptions {
+  int outstanding_req = 0;  // Proposals in flight before propose blocks
+  bool want_tofino = false;
+  ThreadBank thread_bank = ThreadBank::A;
+
+  size_t log_size = DefaultLogSize;
+  HugePages huge_pages = HugePages::None;
+
+  // Part of log_size set aside for the snapshots of the application, the
+  // same on every replica. 0 disables snapshots.
+  size_t snapshot_size = 0;
+
+  // Empty for a volatile log. Otherwise the file (or DAX device) holds the
+  // registered memory, and the log survives a restart.
+  std::string log_path;
+  FlushPolicy flush_policy = FlushPolicy::PerBatch;
+
+  // Index of the entries of the current lap by sequence number
+  bool index_log = true;
+
+  // Threads pre-faulting the registered memory, 0 leaves it to ibv_reg_mr
+  int populate_threads = 8;
+
+  // Depth of the replication send queues and of their completion queue, 0
+  // sizes them from outstanding_req (within the limits of the device)
+  int send_queue_depth = 0;
+  int completion_queue_depth = 0;
+};
+
+// Payload space handed out by Consensus::reserve, directly inside the log
+struct Reservation {
+  uint8_t *buf = nullptr;
+  size_t len = 0;  // Can be shrunk before committing
+  uint64_t id = 0;
+};
+
 /*La classe Consensus est juste un wrapper autour de la classe RdmaConsensus. 
 Elle permet de spécifier des paramètres (ThreadBank, commitHandler, etc..)*/
 class Consensus {
  public:
   Consensus(int my_id, std::vector<int> &remote_ids, int outstanding_req = 0,
             bool want_tofino = false, ThreadBank threadBank = ThreadBank::A);
+  Consensus(int my_id, std::vector<int> &remote_ids,
+            ConsensusOptions const &options);
   ~Consensus();
 
   void commitHandler(
       std::function<void(bool leader, uint8_t *buf, size_t len)> committer);
 
+  // Instead of one call per command: all the commands committed between the
+  // old and the new FUO, as (buf, len) pairs, in a single call
+  void commitBatchHandler(
+      std::function<void(bool leader, std::pair<uint8_t *, size_t> const *cmds,
+                         size_t num)>
+          committer);
+
+  // Opt-in, before attaching the commit handler: the handler is called from a
+  // dedicated apply thread and propose no longer waits for it.
+  // waitApplied(committedIndex()) gives read-after-write.
+  void applyInBackground();
+  uint64_t committedIndex();
+  void waitApplied(uint64_t index);
+
   ProposeError propose(uint8_t *buf, size_t len);
+
+  // The command is the concatenation of the buffers. Buffers inside memory
+  // given to registerMemory are sent without being copied first. The call
+  // then waits for every replica (not just a majority) to have the entry,
+  // after which the buffers can be reused.
+  ProposeError propose(struct iovec const *iov, int iovcnt);
+  void registerMemory(void *addr, size_t len);
+
+  // Replicates all the (buf, len) commands in a single log entry. The commit
+  // handler is called once per command, in order.
+  ProposeError proposeBatch(std::vector<std::pair<uint8_t *, size_t>> &cmds);
+
+  // Returns once the command is posted to the replicas. `ticket` is resolved
+  // by poll()/wait(), which also fire the completion handler.
+  ProposeError proposeAsync(uint8_t *buf, size_t len, uint64_t &ticket);
+  void completionHandler(
+      std::function<void(uint64_t ticket, bool committed)> completer);
+  int poll();
+  bool wait(uint64_t ticket);
+
+  // Zero-copy propose: serialize the command in `r.buf`, then commit it.
+  // Only one reservation can be outstanding at a time.
+  ProposeError reserve(size_t len, Reservation &r);
+  ProposeError commitReserved(Reservation const &r);
+
+  // Thread-safe propose, served by a handover thread started with
+  // spawnHandover that coalesces concurrent commands (group commit)
+  void spawnHandover();
+  ProposeError submit(uint8_t *buf, size_t len);
+  GroupCommitStats groupCommitStats();
+
+  // Leader read lease: while canServeLocalRead() is true, reads can be
+  // answered from the local state without a round trip. readBarrier() renews
+  // the lease when needed and must be called from the proposing thread.
+  bool canServeLocalRead();
+  ProposeError readBarrier();
+
+  // Bounded-staleness reads, served by any replica: true if the local state
+  // lags by at most `max_lag_entries` log entries and `max_lag_us`.
+  // Followers always lag by the last entry they received.
+  ReplicaProgress replicaProgress();
+  bool canServeStaleRead(uint64_t max_lag_entries, uint64_t max_lag_us);
+
+  // Snapshots, in the ConsensusOptions::snapshot_size bytes set aside for
+  // them. `snapshot` serializes the state in at most `capacity` bytes and
+  // returns its length, `restore` replaces the state. takeSnapshot() covers
+  // everything committed so far, installSnapshot() restores the snapshot of
+  // another replica on a follower that lost its state and skips the commands
+  // it covers.
+  void snapshotHandlers(
+      std::function<size_t(uint8_t *buf, size_t capacity)> snapshot,
+      std::function<void(uint8_t const *buf, size_t len)> restore);
+  ProposeError takeSnapshot();
+  ProposeError installSnapshot(int from_id);
+
+  // With a ConsensusOptions::log_path, the registered memory is a file (or a
+  // DAX device) that survives a restart: the log resumes from the persisted
+  // FUO, and installSnapshot(my_id) restores the snapshot kept in it.
+  FlushStats flushStats();
+
+  // Streams the committed entries from sequence number `seq` (numbered from
+  // start up) to `fd`, and moves `seq` past them: call it again later to
+  // continue the stream. importLog() replays such a stream on a follower,
+  // through the commit handler.
+  ProposeError exportLog(int fd, uint64_t &seq);
+  ProposeError importLog(int fd);
+
   int potentialLeader();
   bool blockedResponse();
   std::pair<uint64_t, uint64_t> proposedReplicatedRange();
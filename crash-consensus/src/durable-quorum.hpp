@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "config.hpp"
+#include "context.hpp"
+#include "log-flusher.hpp"
+#include "memory.hpp"
+#include "message-identifier.hpp"
+
+namespace dory {
+/*Le leader ne rapporte une proposition (PerEntry, PerBatch) qu'une fois
+qu'une majorité de répliques, lui compris, a vidé son log au-delà. Il lit la
+FlushMark des autres par RDMA, sur le plan de l'élection (kind FlushMarkRd) :
+au plus une lecture en vol par réplique, chaque réponse est gardée et les
+répliques lentes n'empêchent pas la majorité de conclure.
+
+À utiliser depuis le thread qui propose, comme poll().*/
+class DurableQuorum {
+ public:
+  DurableQuorum() {}
+
+  // `quorum_size` remote replicas, the leader counts for the remaining one
+  DurableQuorum(LeaderContext *ctx, int quorum_size)
+      : ctx{ctx}, quorum_size{quorum_size} {
+    offset = ctx->scratchpad.flushMarkSlotOffset();
+    auto &slots = ctx->scratchpad.readFlushMarkSlots();
+
+    for (auto &[pid, rc] : ctx->cc.ce.connections()) {
+      remotes.push_back(Remote{pid, &rc, slots[pid], false, 0});
+    }
+
+    poller = ctx->poller.getContext(quorum::FlushMarkRd);
+  }
+
+  // Whether a majority flushed the entries of `proposal` up to `position`.
+  // Does not block: posts the reads that are missing and takes the ones that
+  // completed.
+  bool covered(uint64_t proposal, uint64_t position) {
+    if (count(proposal, position) >= quorum_size) {
+      return true;
+    }
+
+    read_marks(proposal, position);
+    return count(proposal, position) >= quorum_size;
+  }
+
+  // Same as covered, until it is. Returns false if `leader` changes or if the
+  // majority did not confirm within ConsensusConfig::flushConfirmTimeoutMs.
+  bool waitFor(uint64_t proposal, uint64_t position,
+               std::atomic<Leader> &leader) {
+    auto deadline =
+        std::chrono::steady_clock::now() +
+        std::chrono::milliseconds(ConsensusConfig::flushConfirmTimeoutMs);
+    int loops = 0;
+
+    while (!covered(proposal, position)) {
+      loops += 1;
+      if (loops % 1024 == 0) {
+        loops = 0;
+        if (leader.load().requester != ctx->cc.my_id) {
+          return false;
+        }
+
+        if (std::chrono::steady_clock::now() > deadline) {
+          return false;
+        }
+      }
+    }
+
+    return true;
+  }
+
+ private:
+  struct Remote {
+    int pid;
+    ReliableConnection *rc;
+    uint8_t *slot;  // Where its mark is read to
+    bool in_flight;
+    uint64_t mark;  // As of the last read that completed
+  };
+
+  int count(uint64_t proposal, uint64_t position) const {
+    int durable = 0;
+    for (auto const &r : remotes) {
+      if (FlushMark::covers(r.mark, proposal, position)) {
+        durable++;
+      }
+    }
+
+    return durable;
+  }
+
+  void read_marks(uint64_t proposal, uint64_t position) {
+    size_t in_flight = 0;
+    for (auto &r : remotes) {
+      if (!r.in_flight && !FlushMark::covers(r.mark, proposal, position)) {
+        // A QP in error fails to post, the next round tries again
+        r.in_flight = r.rc->postSendSingle(
+            ReliableConnection::RdmaRead,
+            quorum::pack(quorum::FlushMarkRd, r.pid, ++read_seq), r.slot,
+            sizeof(uint64_t), r.rc->remoteBuf() + offset);
+      }
+
+      in_flight += r.in_flight ? 1 : 0;
+    }
+
+    if (in_flight == 0) {
+      return;
+    }
+
+    entries.resize(in_flight);
+    if (!poller(ctx->cc.cq, entries)) {
+      return;
+    }
+
+    for (auto const &entry : entries) {
+      auto pid = quorum::unpackPID<int>(entry.wr_id);
+      for (auto &r : remotes) {
+        if (r.pid != pid) {
+          continue;
+        }
+
+        r.in_flight = false;
+        if (entry.status == IBV_WC_SUCCESS) {
+          r.mark = *reinterpret_cast<uint64_t volatile *>(r.slot);
+        }
+      }
+    }
+  }
+
+  LeaderContext *ctx;
+  int quorum_size;
+  ptrdiff_t offset;
+  std::vector<Remote> remotes;
+  PollingContext poller;
+  std::vector<struct ibv_wc> entries;
+  uint64_t read_seq = 0;
+};
+}  // namespace dory
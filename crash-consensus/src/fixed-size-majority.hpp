@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <vector>
 
 #include "branching.hpp"
@@ -34,6 +35,7 @@ template <class QuorumWaiter, class ErrorType> class FixedSizeMajorityOperation
         connections.push_back(Conn(pid, &rc));
       }
     }
+    credits = send_credits();
   }
 
   FixedSizeMajorityOperation(ConnectionContext *context, QuorumWaiter qw,
@@ -54,6 +56,7 @@ template <class QuorumWaiter, class ErrorType> class FixedSizeMajorityOperation
         connections.push_back(Conn(pid, &rc));
       }
     }
+    credits = send_credits();
   }
 
   typename QuorumWaiter::ReqIDType reqID() { return qw.reqID(); }
@@ -68,6 +71,9 @@ template <class QuorumWaiter, class ErrorType> class FixedSizeMajorityOperation
       failed_majority.reset();
       failed_majority.track(req_id);
       qw.reset(req_id);
+      unsignaled = 0;
+      last_posted = {};
+      tail_posted = {};
 
       // TODO (question):
       // To reuse the same req_id, doe we need to make sure no outstanding
@@ -185,14 +191,20 @@ template <class QuorumWaiter, class ErrorType> class FixedSizeMajorityOperation
 
     }
     else{
+    //un réplica lent n'a plus de place dans sa send queue : on attend ses wc
+    if (!wait_for_credits(leader, outstanding_req)) {
+      return false;
+    }
+
     //posting the WR to the QPs
+    auto signaled = should_signal(req_id, outstanding_req);
     for (auto &c : connections) {
       //std::cout << "Posting to "<< c.pid << " by hand " << std::endl;
-      auto ok = c.rc->postSendSingle(
-          ReliableConnection::RdmaWrite,
+      //WR pré-construit (WriteTemplate)
+      auto ok = c.rc->postWrite(
           QuorumWaiter::packer(kind, c.pid, req_id), from_local_memory,
           static_cast<uint32_t>(size),
-          c.rc->remoteBuf() + to_remote_memories[c.pid] + offset, false);  
+          c.rc->remoteBuf() + to_remote_memories[c.pid] + offset, signaled);
       //std::cout << "pids " << connections[0].pid << " " << connections[1].pid << " offsets " << to_remote_memories[connections[0].pid]  << " " << to_remote_memories[connections[1].pid] 
       //     << " we used " << to_remote_memories[2] << " offset " << offset << "\n";
       
@@ -204,49 +216,75 @@ template <class QuorumWaiter, class ErrorType> class FixedSizeMajorityOperation
     }
     }
 
-    //if we use the tofino, we don't need to pull as many WC to continue forward
-    int expected_nr = use_tofino ? outstanding_req+1 : outstanding_req * replicas_size + quorum_size; 
-    auto cq = ctx->cq.get();
-    entries.resize(expected_nr);
-    int num = 0;
-    
-    //if we can no longer send operations, than we process the WC received until the QW gives us a green light
-    while (!qw.canContinueWithOutstanding(outstanding_req, next_req_id)) {
-      num = ibv_poll_cq(cq, expected_nr, &entries[0]);
-      
-      if (num >= 0) {
-        if (!qw.fastConsume(entries, num, expected_nr)) {
-          std::cout << "Fast Consume failed "<< std::endl;
-          return false;
-        }
-      } else {
-        std::cout << "Polled negative value in fastWrite==> failed "<< std::endl;
-        return false;
-      }
+    return fast_wait(req_id, next_req_id, leader, outstanding_req, use_tofino);
+  }
+
+  //comme fastWrite, mais chaque réplica reçoit un seul WR dont le contenu est
+  //rassemblé depuis plusieurs buffers (sge). `after_post` est appelé une fois
+  //les WR postés, pendant que la carte lit les buffers.
+  template <typename Func>
+  bool fastWriteGather(std::vector<struct ibv_sge> &sges,
+                       std::vector<uintptr_t> &to_remote_memories,
+                       uintptr_t offset, std::atomic<Leader> &leader,
+                       int outstanding_req, Func &&after_post) {
+    auto req_id = qw.fetchAndIncFastID();
+    auto next_req_id = qw.nextFastReqID();
+
+    if (!wait_for_credits(leader, outstanding_req)) {
+      return false;
     }
 
-    //même problème que dans le op_with_leader_bail :
-    //il peut y avoir eu un changement de leader pendant que l'on poll 
-    //ce qui causerait la perte de certaines requêtes
-    //donc on vérifie de temps en temps que le leader n'a pas changé
-    //(par contre, ce n'est pas dans le while. Peut-être que comme on attend pas souvent,
-    // c'est plus pertinent de regarder entre deux séries d'envoies )
-    constexpr unsigned mask = (1 << 14) - 1;  // Must be power of 2 minus 1
-    int loops = 0;
-    
-    loops = (loops + 1) & mask;
-    if (loops == 0) {
-      auto ldr = leader.load();
-      if (ldr.requester != ctx->my_id) {
-        return false;
+    auto signaled = should_signal(req_id, outstanding_req);
+    for (auto &c : connections) {
+      auto ok = c.rc->postSendGather(
+          ReliableConnection::RdmaWrite,
+          QuorumWaiter::packer(kind, c.pid, req_id), sges.data(),
+          static_cast<int>(sges.size()),
+          c.rc->remoteBuf() + to_remote_memories[c.pid] + offset, signaled);
+
+      if (!ok) {
+        throw std::runtime_error("Posting to rc for fastWriteGather failed");
       }
     }
-    range_start = req_id;
+
+    after_post();
+
+    return fast_wait(req_id, next_req_id, leader, outstanding_req, false);
+  }
+
+  //comme la boucle de fastWrite, mais sans bloquer : on traite uniquement les
+  //wc déjà présents dans la cq (utilisé pour faire avancer les proposeAsync)
+  bool pollFastWrites(int outstanding_req, bool use_tofino) {
+    int expected_nr = use_tofino ? outstanding_req + 1
+                                 : outstanding_req * replicas_size + quorum_size;
+    expected_nr = std::max(expected_nr, 1);
+    entries.resize(expected_nr);
+
+    int num = ibv_poll_cq(ctx->cq.get(), expected_nr, &entries[0]);
+    if (num < 0) {
+      std::cout << "Polled negative value in pollFastWrites==> failed "<< std::endl;
+      return false;
+    }
+
+    int left = 0;
+    if (!qw.fastConsume(entries, num, left)) {
+      return false;
+    }
+
+    //les derniers writes postés n'ont peut-être pas de wc : si plus rien
+    //n'arrive, un write vide signalé les acquitte
+    if (num == 0 && !use_tofino && outstandingWrites() > 0 &&
+        !signal_tail()) {
+      return false;
+    }
+
     range_end = qw.reqID();
-        
     return true;
   }
 
+  //1 write sur `interval` par QP demande un wc (selective signaling)
+  void signalEvery(int interval) { signal_interval = std::max(interval, 1); }
+
   std::unique_ptr<MaybeError> fastWriteError() {
     auto req_id = qw.reqID();
     return std::make_unique<ErrorType>(req_id);
@@ -254,10 +292,67 @@ template <class QuorumWaiter, class ErrorType> class FixedSizeMajorityOperation
 
 
 
+  //plus petite taille de write que toutes les QPs prennent en inline
+  uint32_t inlineLimit() const {
+    if (connections.empty()) {
+      return 0;
+    }
+
+    uint32_t limit = connections.front().rc->inlineLimit();
+    for (auto &c : connections) {
+      limit = std::min(limit, c.rc->inlineLimit());
+    }
+    return limit;
+  }
+
+  //attend que toutes les répliques, pas seulement la majorité, aient le wc du
+  //dernier write posté : le NIC ne lit plus ses buffers ensuite. Une réplica
+  //qui ne répond plus fait attendre jusqu'à ce que sa QP passe en erreur.
+  bool waitAllAcknowledged(std::atomic<Leader> &leader, int outstanding_req) {
+    int expected_nr = std::max(outstanding_req * replicas_size + quorum_size, 1);
+    entries.resize(expected_nr);
+    int loops = 0;
+
+    while (!all_acknowledged(last_posted)) {
+      int num = ibv_poll_cq(ctx->cq.get(), expected_nr, &entries[0]);
+      if (num < 0) {
+        std::cout << "Polled negative value while waiting for all the replicas"
+                  << std::endl;
+        return false;
+      }
+
+      int left = 0;
+      if (!qw.fastConsume(entries, num, left)) {
+        return false;
+      }
+
+      //le write n'est peut-être pas signalé
+      if (num == 0 && !signal_tail()) {
+        return false;
+      }
+
+      loops += 1;
+      if (loops % 1024 == 0) {
+        loops = 0;
+        auto ldr = leader.load();
+        if (ldr.requester != ctx->my_id) {
+          return false;
+        }
+      }
+    }
+
+    return true;
+  }
+
   std::vector<int> &successes() { return successful_ops; }
 
   uint64_t latestReplicatedID() { return uint64_t(qw.reqID()); }
 
+  //nombre de fastWrite postés dont on n'a pas encore le quorum
+  uint64_t outstandingWrites() {
+    return uint64_t(qw.nextFastReqID() - qw.reqID());
+  }
+
  private:
   template <class T>  std::unique_ptr<MaybeError> op_with_leader_bail( ReliableConnection::RdmaReq rdma_req, 
                                                                         T const &local_memory,
@@ -325,6 +420,8 @@ template <class QuorumWaiter, class ErrorType> class FixedSizeMajorityOperation
     }
 
     qw.setFastReqID(next_req_id);
+    range_start = req_id;
+    range_end = qw.reqID();
     return std::make_unique<NoError>();
   }
 
@@ -385,6 +482,173 @@ template <class QuorumWaiter, class ErrorType> class FixedSizeMajorityOperation
     return std::make_unique<NoError>();
   }
 
+  //le write `req_id` est signalé au plus tard `outstanding_req` writes après
+  //le dernier signalé : fast_wait attend justement le wc du write posté
+  //`outstanding_req` writes plus tôt, il arrive donc toujours
+  bool should_signal(typename QuorumWaiter::ReqIDType req_id,
+                     int outstanding_req) {
+    auto interval = std::min(signal_interval, outstanding_req + 1);
+    last_posted = req_id;
+    if (++unsignaled >= interval) {
+      unsignaled = 0;
+      return true;
+    }
+
+    return false;
+  }
+
+  //write de 0 octet signalé, avec le seq du dernier write posté. Un seul à
+  //la fois dans les send queues : tant que le précédent n'a pas son wc, c'est
+  //lui qui débloquera l'attente
+  bool signal_tail() {
+    if (unsignaled == 0 || !tail_acknowledged()) {
+      return true;
+    }
+
+    for (auto &c : connections) {
+      auto ok = c.rc->postSendGather(
+          ReliableConnection::RdmaWrite,
+          QuorumWaiter::packer(kind, c.pid, last_posted), nullptr, 0,
+          c.rc->remoteBuf());
+      if (!ok) {
+        return false;
+      }
+    }
+
+    unsignaled = 0;
+    tail_posted = last_posted;
+    return true;
+  }
+
+  bool tail_acknowledged() const { return all_acknowledged(tail_posted); }
+
+  bool all_acknowledged(typename QuorumWaiter::ReqIDType req_id) const {
+    for (auto &c : connections) {
+      if (qw.unacknowledged(c.pid, req_id) > 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  //plus petite send queue des connexions, moins ce qui est gardé pour le
+  //write de fin (signal_tail) et les opérations du slow path
+  int send_credits() const {
+    if (connections.empty()) {
+      return 0;
+    }
+
+    int depth = connections.front().rc->sendDepth();
+    for (auto &c : connections) {
+      depth = std::min(depth, c.rc->sendDepth());
+    }
+    return std::max(depth - ReservedWRs, 1);
+  }
+
+  bool has_credits() const {
+    for (auto &c : connections) {
+      if (qw.unacknowledged(c.pid, last_posted) >= credits) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  //contrôle de flux par crédits : un write occupe une place dans la send
+  //queue de chaque réplica jusqu'à son wc (ou celui d'un write signalé plus
+  //tard). fast_wait ne borne que les requêtes sans quorum, un réplica hors du
+  //quorum peut donc prendre du retard : quand il n'a plus de crédit, on
+  //traite les wc au lieu de poster, sinon ibv_post_send échouerait
+  bool wait_for_credits(std::atomic<Leader> &leader, int outstanding_req) {
+    if (has_credits()) {
+      return true;
+    }
+
+    int expected_nr = std::max(outstanding_req * replicas_size + quorum_size, 1);
+    entries.resize(expected_nr);
+    int loops = 0;
+
+    while (!has_credits()) {
+      int num = ibv_poll_cq(ctx->cq.get(), expected_nr, &entries[0]);
+      if (num < 0) {
+        std::cout << "Polled negative value while waiting for credits"
+                  << std::endl;
+        return false;
+      }
+
+      int left = 0;
+      if (!qw.fastConsume(entries, num, left)) {
+        return false;
+      }
+
+      //les writes en retard n'ont peut-être pas de wc
+      if (num == 0 && !signal_tail()) {
+        return false;
+      }
+
+      //même précaution que dans op_with_leader_bail
+      loops += 1;
+      if (loops % 1024 == 0) {
+        loops = 0;
+        auto ldr = leader.load();
+        if (ldr.requester != ctx->my_id) {
+          return false;
+        }
+      }
+    }
+
+    return true;
+  }
+
+  //attente commune à fastWrite et fastWriteGather : on traite les wc jusqu'à
+  //ce qu'il ne reste pas plus de `outstanding_req` requêtes en vol
+  bool fast_wait(typename QuorumWaiter::ReqIDType req_id,
+                 typename QuorumWaiter::ReqIDType next_req_id,
+                 std::atomic<Leader> &leader, int outstanding_req,
+                 bool use_tofino) {
+    //if we use the tofino, we don't need to pull as many WC to continue forward
+    int expected_nr = use_tofino ? outstanding_req+1 : outstanding_req * replicas_size + quorum_size; 
+    auto cq = ctx->cq.get();
+    entries.resize(expected_nr);
+    int num = 0;
+    
+    //if we can no longer send operations, than we process the WC received until the QW gives us a green light
+    while (!qw.canContinueWithOutstanding(outstanding_req, next_req_id)) {
+      num = ibv_poll_cq(cq, expected_nr, &entries[0]);
+      
+      if (num >= 0) {
+        if (!qw.fastConsume(entries, num, expected_nr)) {
+          std::cout << "Fast Consume failed "<< std::endl;
+          return false;
+        }
+      } else {
+        std::cout << "Polled negative value in fastWrite==> failed "<< std::endl;
+        return false;
+      }
+    }
+
+    //même problème que dans le op_with_leader_bail :
+    //il peut y avoir eu un changement de leader pendant que l'on poll 
+    //ce qui causerait la perte de certaines requêtes
+    //donc on vérifie de temps en temps que le leader n'a pas changé
+    //(par contre, ce n'est pas dans le while. Peut-être que comme on attend pas souvent,
+    // c'est plus pertinent de regarder entre deux séries d'envoies )
+    constexpr unsigned mask = (1 << 14) - 1;  // Must be power of 2 minus 1
+    int loops = 0;
+    
+    loops = (loops + 1) & mask;
+    if (loops == 0) {
+      auto ldr = leader.load();
+      if (ldr.requester != ctx->my_id) {
+        return false;
+      }
+    }
+    range_start = req_id;
+    range_end = qw.reqID();
+        
+    return true;
+  }
+
  private:
  //couple (pid, rc)
   struct Conn {
@@ -401,6 +665,15 @@ template <class QuorumWaiter, class ErrorType> class FixedSizeMajorityOperation
 
   int quorum_size, replicas_size; 
 
+  int signal_interval = 1;
+  int unsignaled = 0;  //writes postés depuis le dernier signalé
+  typename QuorumWaiter::ReqIDType last_posted{};
+  typename QuorumWaiter::ReqIDType tail_posted{};  //seq du dernier write de fin
+
+  //places de la send queue gardées hors des crédits du fast path
+  static constexpr int ReservedWRs = 2;
+  int credits = 0;
+
   FailureTracker failed_majority;
 
   std::vector<struct ibv_wc> entries;
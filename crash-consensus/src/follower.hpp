@@ -1,14 +1,22 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <functional>
 #include <mutex>
 #include <stdexcept>
+#include <string>
 #include <thread>
 
+#include "committer.hpp"
 #include "config.hpp"
 #include "context.hpp"
+#include "log-flusher.hpp"
+#include "log-reclaimer.hpp"
 #include "log-recycling.hpp"
 #include "log.hpp"
+#include "progress-tracker.hpp"
+#include "snapshot.hpp"
 
 namespace dory {
 class Follower {
@@ -17,11 +25,17 @@ class Follower {
 
   Follower(ReplicationContext *ctx, LeaderContext *le_ctx,
            BlockingIterator *iter, LiveIterator *commit_iter,
+           Committer *committer, ProgressTracker *progress,
+           LogReclaimer *reclaimer, LogFlusher *flusher,
            ConsensusConfig::ThreadConfig threadConfig)
       : ctx{ctx},
         le_ctx{le_ctx},
         iter{iter},
         commit_iter{commit_iter},
+        committer{committer},
+        progress{progress},
+        reclaimer{reclaimer},
+        flusher{flusher},
         block_thread_req{false},
         blocked_thread{false},
         blocked_state{false},
@@ -40,14 +54,17 @@ class Follower {
   }
 
   void attach(std::unique_ptr<LogSlotReader> *lsreader,
-              ScratchpadMemory *scratchpad_memory) {
+              ScratchpadMemory *scratchpad_memory,
+              SnapshotStore *snapshot_store) {
     lsr = lsreader;
     scratchpad = scratchpad_memory;
+    snapshots = snapshot_store;
   }
 
   void waitForPoller() {
     le_ctx->poller.registerContext(quorum::RecyclingDone);
-    le_ctx->poller.endRegistrations(4);
+    le_ctx->poller.registerContext(quorum::SnapshotRd);
+    le_ctx->poller.endRegistrations(6);
   }
 
   void block() {
@@ -60,10 +77,6 @@ class Follower {
     }
   }
 
-  template <typename Func> void commitHandler(Func f) {
-    commit = std::move(f);
-  }
-
   void unblock() {
     if (blocked_state) {
       // if (!blocked_thread.load()) {
@@ -76,6 +89,75 @@ class Follower {
 
   inline std::mutex &lock() { return log_mutex; }
 
+  // Runs `t` on the follower thread, between two log entries. Returns false,
+  // without running it, if the thread got blocked first (the log now belongs
+  // to the leader side).
+  bool runTask(std::function<void()> t) {
+    task = std::move(t);
+    task_state.store(TaskPosted);
+
+    while (true) {
+      auto state = task_state.load();
+      if (state == TaskDone) {
+        task_state.store(TaskIdle);
+        return true;
+      }
+
+      if (state == TaskPosted && blocked_thread.load()) {
+        if (task_state.compare_exchange_strong(state, TaskIdle)) {
+          return false;
+        }
+      }
+    }
+  }
+
+  // Reads the snapshot of `pid` into the local snapshot area, with bulk RDMA
+  // reads. Called from a task. Returns false if `pid` has no snapshot, or if
+  // it kept changing while being read (the local one is lost either way).
+  bool fetchSnapshot(int pid) {
+    auto &c_ctx = le_ctx->cc;
+    auto &rcs = c_ctx.ce.connections();
+    auto rc_it = rcs.find(pid);
+    if (rc_it == rcs.end()) {
+      throw std::runtime_error("Unknown replica " + std::to_string(pid));
+    }
+
+    auto &rc = rc_it->second;
+    auto remote = rc.remoteBuf() + snapshots->offset();
+    snapshot_poller = le_ctx->poller.getContext(quorum::SnapshotRd);
+
+    snapshots->beginWrite();
+
+    for (int i = 0; i < ConsensusConfig::snapshotFetchAttempts; i++) {
+      auto *remote_header = snapshots->remoteHeader();
+
+      readRemote(rc, pid, reinterpret_cast<uint8_t *>(remote_header),
+                 sizeof(SnapshotStore::Header), remote);
+      auto before = *remote_header;
+
+      if (before.seq % 2 != 0) {
+        continue;
+      }
+
+      if (before.position == 0 || before.length > snapshots->capacity()) {
+        break;
+      }
+
+      readRemote(rc, pid, snapshots->data(), before.length,
+                 remote + SnapshotStore::dataOffset());
+      readRemote(rc, pid, reinterpret_cast<uint8_t *>(remote_header),
+                 sizeof(SnapshotStore::Header), remote);
+
+      if (SnapshotStore::consistent(before, *remote_header)) {
+        snapshots->publish(before);
+        return true;
+      }
+    }
+
+    snapshots->publish(SnapshotStore::Header{0, 0, 0, 0});
+    return false;
+  }
+
   // Move assignment operator
   Follower &operator=(Follower &&o) {
     if (&o == this) {
@@ -86,6 +168,10 @@ class Follower {
     le_ctx = o.le_ctx;
     iter = o.iter;
     commit_iter = o.commit_iter;
+    committer = o.committer;
+    progress = o.progress;
+    reclaimer = o.reclaimer;
+    flusher = o.flusher;
     block_thread_req.store(o.block_thread_req.load());
     blocked_thread.store(o.blocked_thread.load());
     blocked_state = o.blocked_state;
@@ -102,6 +188,12 @@ class Follower {
       loops = (loops + 1) & mask; //ça limite la valeur de loop, jusqu'à 2**14-1
 
       if (loops == 0) {         //cad si on a fait un tour complet des valeurs de 0 à 2**14-1 ==> de temps en temps, on check 
+        int expected = TaskPosted;
+        if (task_state.compare_exchange_strong(expected, TaskRunning)) {
+          task();
+          task_state.store(TaskDone);
+        }
+
         if (block_thread_req.load()) {    
           blocked_thread.store(true);   //blocking the thread
           block_thread_req.store(false);  //ack the request 
@@ -122,7 +214,13 @@ class Follower {
         continue;
       }
 
+      auto sampled_at = ProgressTracker::Clock::now();
       ParsedSlot pslot(iter->location());
+      ctx->log.indexEntry(iter->location());
+      flusher->written(ctx->log.ringPosition(
+                           iter->location() - ctx->log.headerPtr() +
+                           LogConfig::round_up_powerof2(pslot.totalLength())),
+                       pslot.acceptedProposal());
       // std::cout << "Discovered element on position " <<
       // uintptr_t(iter->location()) << std::endl; std::cout << "Accepted
       // proposal " << pslot.acceptedProposal()
@@ -152,15 +250,26 @@ class Follower {
         recycling_requested = true;
 
         // std::cout << "Fuo encoded inside the 0: " << fuo << std::endl;
+      } else {
+        progress->received();
       }
 
       //std::cout << "Commit up to " << fuo << std::endl;
 
+      uint64_t committed_entries = 0;
       while (commit_iter->hasNext(fuo)) {
         commit_iter->next();
+        committed_entries++;
 
         ParsedSlot pslot(commit_iter->location());
-        auto [buf, len] = pslot.payload();
+
+        // Already in the snapshot the application restored
+        if (unlikely(snapshots->covers(ctx->log.ringPosition(
+                commit_iter->location() - ctx->log.headerPtr())))) {
+          ctx->log.updateHeaderFirstUndecidedOffset(fuo);
+          continue;
+        }
+
         // std::cout << "Committing element on position " <<
         // uintptr_t(commit_iter->location()) << std::endl; std::cout <<
         // "Accepted proposal " << pslot.acceptedProposal()
@@ -173,22 +282,42 @@ class Follower {
         // std::endl;
         // std::cout << std::endl;
 
-        commit(false, buf, len);
+        pslot.forEachRecord([this](uint8_t *buf, size_t len) {
+          committer->append(buf, len);
+        });
 
         // Bookkeeping
         ctx->log.updateHeaderFirstUndecidedOffset(fuo);
       }
 
-      if (unlikely(recycling_requested)) {
-        // std::cout << "Resetting" << std::endl;
-        ctx->log.resetFUO();
-        ctx->log.rebuildLog();
+      // Everything up to the new FUO in a single call
+      committer->flush(false);
+      flusher->committed(ctx->log.ringPosition(fuo));
+      progress->committed(fuo, committed_entries, sampled_at);
 
-        *iter = ctx->log.blockingIterator();
-        *commit_iter = ctx->log.liveIterator();
-        *lsr = std::make_unique<LogSlotReader>(
-            ctx, *scratchpad, ctx->log.headerFirstUndecidedOffset());
-        ctx->log.bzero();
+      if (unlikely(recycling_requested)) {
+        // The commands point inside the log
+        committer->drain();
+        reclaimer->reclaimUpTo(recycling_req.reclaim_up_to);
+
+        if (recycling_req.wrap) {
+          // std::cout << "Resetting" << std::endl;
+          auto offset = iter->location() - ctx->log.headerPtr();
+          ctx->log.wrap(offset + LogConfig::round_up_powerof2(
+                                     ParsedSlot(iter->location()).totalLength()));
+
+          *iter = ctx->log.blockingIterator();
+          *commit_iter = ctx->log.liveIterator();
+          *lsr = std::make_unique<LogSlotReader>(
+              ctx, *scratchpad, ctx->log.headerFirstUndecidedOffset());
+          flusher->committed(
+              ctx->log.ringPosition(ctx->log.headerFirstUndecidedOffset()));
+          progress->committed(ctx->log.headerFirstUndecidedOffset(), 0,
+                              sampled_at);
+        } else {
+          ctx->log.enterSegment(
+              ctx->log.segmentOf(iter->location() - ctx->log.headerPtr()));
+        }
 
         // Notify that recycling occurred
         notifyRecyclingRequestor();
@@ -249,6 +378,43 @@ class Follower {
     return std::make_unique<NoError>();
   }
 
+  // Reads `len` bytes at `remote` in `pid` into `buf`, in chunks
+  void readRemote(ReliableConnection &rc, int pid, uint8_t *buf, size_t len,
+                  uintptr_t remote) {
+    auto &c_ctx = le_ctx->cc;
+    auto chunk = ConsensusConfig::snapshotReadChunk;
+    size_t chunks = (len + chunk - 1) / chunk;
+    size_t posted = 0;
+    size_t completed = 0;
+
+    while (completed < chunks) {
+      while (posted < chunks &&
+             posted - completed < ConsensusConfig::snapshotReadWindow) {
+        auto start = posted * chunk;
+        auto n = std::min(chunk, len - start);
+        rc.postSendSingle(
+            ReliableConnection::RdmaRead,
+            quorum::pack(quorum::SnapshotRd, pid, ++snapshot_read_seq),
+            buf + start, static_cast<uint32_t>(n), remote + start);
+        posted++;
+      }
+
+      entries.resize(posted - completed);
+      if (!snapshot_poller(c_ctx.cq, entries)) {
+        std::cout << "Poll returned an error" << std::endl;
+        continue;
+      }
+
+      for (auto const &entry : entries) {
+        if (entry.status != IBV_WC_SUCCESS) {
+          throw std::runtime_error(
+              "Unimplemented: We don't support failures yet");
+        }
+        completed++;
+      }
+    }
+  }
+
  private:
   ReplicationContext *ctx;
   LeaderContext *le_ctx;
@@ -259,7 +425,11 @@ class Follower {
   std::unique_ptr<LogSlotReader> *lsr;
   ScratchpadMemory *scratchpad;
   
-  std::function<void(bool, uint8_t *, size_t)> commit;
+  Committer *committer;
+  ProgressTracker *progress;
+  LogReclaimer *reclaimer;
+  LogFlusher *flusher;
+  SnapshotStore *snapshots;
 
   std::thread follower_thd;
 
@@ -272,5 +442,13 @@ class Follower {
   PollingContext recycling_req_poller;
   LogRecyclingRequest recycling_req;
   std::vector<struct ibv_wc> entries;
+
+  // Work handed over by runTask
+  enum TaskState { TaskIdle, TaskPosted, TaskRunning, TaskDone };
+  std::function<void()> task;
+  alignas(64) std::atomic<int> task_state{TaskIdle};
+
+  PollingContext snapshot_poller;
+  uint64_t snapshot_read_seq = 0;
 };
 }  // namespace dory
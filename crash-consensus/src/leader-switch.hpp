@@ -4,8 +4,10 @@
 #include "log.hpp"
 #include "message-identifier.hpp"
 
+#include <chrono>
 #include <iterator>
 #include <set>
+#include <thread>
 
 #include "context.hpp"
 #include "remote-log-reader.hpp"
@@ -62,7 +64,7 @@ class LeaderHeartbeat {
 
     //??
     ctx->poller.registerContext(quorum::LeaderHeartbeat);
-    ctx->poller.endRegistrations(4);
+    ctx->poller.endRegistrations(6);
     heartbeat_poller = ctx->poller.getContext(quorum::LeaderHeartbeat);
 
     post_id = 0;
@@ -317,7 +319,7 @@ class LeaderPermissionAsker {
   void startPoller() {
     ctx->poller.registerContext(quorum::LeaderReqWr);
     ctx->poller.registerContext(quorum::LeaderGrantWr);
-    ctx->poller.endRegistrations(4);
+    ctx->poller.endRegistrations(6);
 
     ask_perm_poller = ctx->poller.getContext(quorum::LeaderReqWr);
     give_perm_poller = ctx->poller.getContext(quorum::LeaderGrantWr);
@@ -655,6 +657,8 @@ class LeaderSwitcher {
             }
           }
 
+          auto revoked_at = std::chrono::steady_clock::now();
+
           follower.block();
 
           if (!permission_asker.waitForApprovalStep2(current_leader, leader)) {
@@ -662,6 +666,7 @@ class LeaderSwitcher {
             return false;
           };
 
+          wait_out_lease(revoked_at);
           leader_mode.store(true);
 
           std::cout << "Permissions granted" << std::endl;
@@ -678,6 +683,8 @@ class LeaderSwitcher {
             IGNORE(pid);
             rc.reset();
           }
+          wait_out_lease(std::chrono::steady_clock::now());
+
           // Re-configure the connections
           for (auto &[pid, rc] : *replicator_rcs) {
             if (pid == current_leader.requester) {
@@ -708,6 +715,8 @@ class LeaderSwitcher {
             }
           }
 
+          wait_out_lease(std::chrono::steady_clock::now());
+
           // Then grant to new leader
           auto new_leader = replicator_rcs->find(current_leader.requester);
           if (new_leader != replicator_rcs->end()) {
@@ -774,6 +783,14 @@ class LeaderSwitcher {
   }
 
  private:
+  // L'ancien leader peut encore servir des lectures locales pendant
+  // leaderLeaseNs après sa dernière écriture chez nous : on ne donne les
+  // droits au suivant qu'une fois ce bail expiré.
+  void wait_out_lease(std::chrono::steady_clock::time_point revoked_at) {
+    std::this_thread::sleep_until(
+        revoked_at + std::chrono::nanoseconds(ConsensusConfig::leaderLeaseNs));
+  }
+
   void prepareScanner() {
     current_reading.resize(sz);
 
@@ -0,0 +1,330 @@
+#pragma once
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+#include "config.hpp"
+#include "log.hpp"
+#include "pinning.hpp"
+
+namespace dory {
+/*Jusqu'où une réplique a rendu son log durable, dans son scratchpad
+(ScratchpadMemory::flushMarkSlot) où le leader vient le lire (DurableQuorum).
+C'est un seul mot, qu'une lecture RDMA ne voit jamais à moitié écrit : les 16
+bits de poids fort viennent de la proposition de la dernière entrée reçue, les
+48 autres de sa position dans l'anneau (modulo 2^48, comparée en arithmétique
+circulaire). Sans la proposition, le leader prendrait pour la sienne une
+marque posée sur les entrées du leader précédent, qu'il a peut-être réécrites.*/
+struct FlushMark {
+  static constexpr int PositionBits = 48;
+  static constexpr uint64_t PositionMask = (1ULL << PositionBits) - 1;
+  static constexpr uint64_t ProposalMask = (1ULL << (64 - PositionBits)) - 1;
+
+  static inline uint64_t pack(uint64_t proposal, uint64_t position) {
+    return ((proposal & ProposalMask) << PositionBits) |
+           (position & PositionMask);
+  }
+
+  // The replica flushed the entries of `proposal` up to `position`
+  static inline bool covers(uint64_t mark, uint64_t proposal,
+                            uint64_t position) {
+    if ((mark >> PositionBits) != (proposal & ProposalMask)) {
+      return false;
+    }
+
+    return ((mark - position) & PositionMask) < (1ULL << (PositionBits - 1));
+  }
+};
+
+/*Rend le log durable quand il vit dans un fichier ou un device DAX (voir
+MappedFile), selon la FlushPolicy. Les boucles de réplication appellent
+written() pour chaque entrée qui arrive dans le log local, et committed() à la
+fin de chaque tour de commit, avec des positions dans l'anneau
+(Log::ringPosition) : le flusher sait ce qui n'est pas encore durable, même
+quand le log revient au début.
+
+Sur un mapping MAP_SYNC il suffit de vider les lignes de cache (clwb, sinon
+clflushopt ou clflush, comme dans experiments-master/rnbd-mmap), sinon on
+passe par msync. Le header du log (proposition, FUO, tour) part avec chaque
+flush, c'est lui qu'un redémarrage retrouve.
+
+Avec PerEntry et PerBatch, chaque fin de tour de commit publie la FlushMark
+(publishTo) : le leader ne rapporte une proposition qu'une fois qu'une
+majorité l'a vidée. Un nouveau leader réécrit ce qui suit le FUO, une entrée
+d'une autre proposition fait donc repartir le flush du FUO.*/
+class LogFlusher {
+ public:
+  using Policy = ConsensusConfig::FlushPolicy;
+
+  struct Stats {
+    uint64_t entries;  // Log entries written while durable
+    uint64_t flushes;
+    uint64_t bytes;
+    uint64_t ns;  // Spent flushing, ns / entries is the cost per entry
+  };
+
+  LogFlusher(Log &log, Policy policy, bool dax)
+      : log{log},
+        policy{policy},
+        dax{dax},
+        write_back{pickWriteBack()},
+        flushed{log.ringPosition(log.tailOffset())},
+        received{flushed},
+        committed_at{flushed},
+        dirty{flushed} {
+#if !defined(__x86_64__)
+    // No cache line write-backs here, msync works everywhere
+    this->dax = false;
+#endif
+  }
+
+  void spawn(ConsensusConfig::ThreadConfig const &threadConfig) {
+    if (policy != Policy::Async) {
+      return;
+    }
+
+    flush_thd = std::thread([this]() { run(); });
+
+    if (threadConfig.pinThreads) {
+      pinThreadToCore(flush_thd, threadConfig.flushThreadCoreID);
+    }
+
+    if (ConsensusConfig::nameThreads) {
+      setThreadName(flush_thd, ConsensusConfig::flushThreadName);
+    }
+  }
+
+  inline bool durable() const { return policy != Policy::None; }
+
+  // Whether the leader waits for a majority of flushed logs (see FlushMark)
+  inline bool majorityDurable() const {
+    return policy == Policy::PerEntry || policy == Policy::PerBatch;
+  }
+
+  // Where committed() publishes the FlushMark, nullptr to stop
+  void publishTo(uint8_t *slot) { mark = reinterpret_cast<uint64_t *>(slot); }
+
+  // An entry of `proposal` that ends at `position` is in the local log
+  inline void written(uint64_t position, uint64_t proposal) {
+    if (policy == Policy::None) {
+      return;
+    }
+
+    entries.store(entries.load(std::memory_order_relaxed) + 1,
+                  std::memory_order_relaxed);
+
+    if (proposal != last_proposal) {
+      last_proposal = proposal;
+
+      // Past the FUO, the log may be what the new leader rewrote
+      if (majorityDurable() && committed_at < flushed) {
+        flushed = committed_at;
+      }
+    }
+    received = std::max(received, position);
+
+    if (policy == Policy::PerEntry) {
+      persistUpTo(position);
+    } else if (policy == Policy::Async) {
+      dirty.store(position, std::memory_order_release);
+    }
+  }
+
+  // End of a commit round, everything up to `position` is committed. With
+  // PerBatch, what was received past it is flushed as well: the leader counts
+  // on it before the next round.
+  inline void committed(uint64_t position) {
+    committed_at = position;
+
+    if (policy == Policy::PerBatch) {
+      persistUpTo(std::max(position, received));
+    }
+
+    if (mark != nullptr && majorityDurable()) {
+      *mark = FlushMark::pack(last_proposal, flushed);
+    }
+  }
+
+  // Memory outside of the log that must survive as well (the snapshot)
+  void persistRange(uint8_t *ptr, size_t len) {
+    if (policy == Policy::None) {
+      return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    flush(ptr, len);
+    fence();
+    account(len, start);
+  }
+
+  Stats stats() const {
+    return Stats{entries.load(std::memory_order_relaxed),
+                 flushes.load(std::memory_order_relaxed),
+                 bytes.load(std::memory_order_relaxed),
+                 ns.load(std::memory_order_relaxed)};
+  }
+
+ private:
+  enum class WriteBack { Clwb, ClflushOpt, Clflush };
+
+  void run() {
+    auto const interval =
+        std::chrono::microseconds(ConsensusConfig::asyncFlushIntervalUs);
+
+    while (true) {
+      auto position = dirty.load(std::memory_order_acquire);
+      if (position > flushed) {
+        persistUpTo(position);
+      }
+
+      std::this_thread::sleep_for(interval);
+    }
+  }
+
+  void persistUpTo(uint64_t position) {
+    if (position <= flushed) {
+      return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto base = log.headerPtr();
+    auto lap_len = log.length();
+    size_t len = 0;
+
+    // The log went back to its beginning, the end of the previous lap first
+    if (position / lap_len != flushed / lap_len) {
+      auto from = flushed % lap_len;
+      auto to = log.previousLapEnd();
+      if (to > from) {
+        flush(base + from, to - from);
+        len += to - from;
+      }
+
+      flushed = position / lap_len * lap_len + log.firstEntryOffset();
+    }
+
+    if (position > flushed) {
+      flush(base + flushed % lap_len, position - flushed);
+      len += position - flushed;
+    }
+
+    flush(base, sizeof(Log::LogHeader));
+    fence();
+
+    flushed = position;
+    account(len, start);
+  }
+
+  void flush(uint8_t *ptr, size_t len) {
+    if (!dax) {
+      auto page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+      auto from = reinterpret_cast<uintptr_t>(ptr) / page * page;
+      auto to = reinterpret_cast<uintptr_t>(ptr) + len;
+
+      // The NIC writes the pages behind the back of the kernel, once written
+      // back they would not be seen dirty again and msync would skip them. A
+      // no-op atomic write from the CPU dirties each page without racing with
+      // the NIC.
+      for (auto p = from; p < to; p += page) {
+        __atomic_fetch_or(reinterpret_cast<uint8_t *>(p), uint8_t(0),
+                          __ATOMIC_RELAXED);
+      }
+
+      if (msync(reinterpret_cast<void *>(from), to - from, MS_SYNC) != 0) {
+        throw std::runtime_error("Could not flush the log to its file");
+      }
+      return;
+    }
+
+#if defined(__x86_64__)
+    constexpr uintptr_t line = 64;
+    auto from = reinterpret_cast<uintptr_t>(ptr) & ~(line - 1);
+    auto to = reinterpret_cast<uintptr_t>(ptr) + len;
+
+    for (auto p = from; p < to; p += line) {
+      auto addr = reinterpret_cast<volatile char *>(p);
+      switch (write_back) {
+        case WriteBack::Clwb:
+          asm volatile(".byte 0x66; xsaveopt %0" : "+m"(*addr));
+          break;
+        case WriteBack::ClflushOpt:
+          asm volatile(".byte 0x66; clflush %0" : "+m"(*addr));
+          break;
+        case WriteBack::Clflush:
+        default:
+          asm volatile("clflush (%0)" ::"r"(addr) : "memory");
+          break;
+      }
+    }
+#endif
+  }
+
+  inline void fence() {
+#if defined(__x86_64__)
+    if (dax) {
+      asm volatile("sfence" ::: "memory");
+    }
+#endif
+  }
+
+  inline void account(size_t len, std::chrono::steady_clock::time_point start) {
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+    flushes.fetch_add(1, std::memory_order_relaxed);
+    bytes.fetch_add(len, std::memory_order_relaxed);
+    ns.fetch_add(static_cast<uint64_t>(elapsed), std::memory_order_relaxed);
+  }
+
+  static WriteBack pickWriteBack() {
+#if defined(__x86_64__)
+    unsigned a, b, c, d;
+    if (__get_cpuid_count(7, 0, &a, &b, &c, &d)) {
+      if (b & (1U << 24)) {
+        return WriteBack::Clwb;
+      }
+
+      if (b & (1U << 23)) {
+        return WriteBack::ClflushOpt;
+      }
+    }
+#endif
+
+    return WriteBack::Clflush;
+  }
+
+  Log &log;
+  Policy policy;
+  bool dax;
+  WriteBack write_back;
+  std::thread flush_thd;
+
+  // Owned by the thread that flushes (the log owner, or flush_thd in Async)
+  uint64_t flushed;
+
+  // Owned by the log owner
+  uint64_t received;
+  uint64_t committed_at;
+  uint64_t last_proposal = 0;
+  uint64_t volatile *mark = nullptr;
+
+  alignas(64) std::atomic<uint64_t> dirty;
+  alignas(64) std::atomic<uint64_t> entries{0};
+  std::atomic<uint64_t> flushes{0};
+  std::atomic<uint64_t> bytes{0};
+  std::atomic<uint64_t> ns{0};
+};
+}  // namespace dory
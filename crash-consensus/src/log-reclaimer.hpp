@@ -0,0 +1,112 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "config.hpp"
+#include "log.hpp"
+#include "pinning.hpp"
+#include "readerwriterqueue.h"
+
+namespace dory {
+/*Remet à zéro, en arrière-plan, les parties du log que les requêtes de
+recyclage libèrent (voir LogRecycling). Le thread a la priorité la plus basse
+et procède par morceaux de reclaimChunk octets, avec des écritures
+non-temporelles pour ne pas vider les caches du chemin de réplication.
+
+Le watermark est la position (Log::ringPosition) jusqu'à laquelle le log est
+à zéro. Le leader et le follower n'attendent dessus qu'au moment de traiter la
+requête suivante, s'il est encore derrière la cible précédente.*/
+class LogReclaimer {
+ public:
+  LogReclaimer(Log &log) : log{log}, watermark{log.reclaimTarget()} {}
+
+  void spawn(ConsensusConfig::ThreadConfig const &threadConfig) {
+    reclaim_thd = std::thread([this]() { run(); });
+
+    if (threadConfig.pinThreads) {
+      pinThreadToCore(reclaim_thd, threadConfig.reclaimThreadCoreID);
+    }
+
+    setThreadIdle(reclaim_thd);
+
+    if (ConsensusConfig::nameThreads) {
+      setThreadName(reclaim_thd, ConsensusConfig::reclaimThreadName);
+    }
+  }
+
+  // Called by the owner of the log, once the commands up to `position` are
+  // applied. Waits until the previous target is zero.
+  void reclaimUpTo(uint64_t position) {
+    waitFor(log.reclaimTarget());
+
+    for (auto const &r : log.reclaimUpTo(position)) {
+      queue.enqueue(r);
+    }
+  }
+
+  inline uint64_t zeroedUpTo() const {
+    return watermark.load(std::memory_order_acquire);
+  }
+
+  void waitFor(uint64_t position) const {
+    while (zeroedUpTo() < position) {
+      ;
+    }
+  }
+
+ private:
+  void run() {
+    Log::ReclaimRange r;
+
+    while (true) {
+      // Sleeps between requests, they come once per ring segment
+      queue.wait_dequeue(r);
+
+      size_t done = 0;
+      do {
+        auto n = std::min(ConsensusConfig::reclaimChunk, r.len - done);
+        zero(r.ptr + done, n);
+        done += n;
+
+        watermark.store(r.position + done, std::memory_order_release);
+      } while (done < r.len);
+    }
+  }
+
+  static void zero(uint8_t *buf, size_t len) {
+#ifdef __SSE2__
+    // The ranges are made of whole log entries, hence 64-byte aligned
+    if (reinterpret_cast<uintptr_t>(buf) % sizeof(__m128i) == 0 &&
+        len % sizeof(__m128i) == 0) {
+      auto *p = reinterpret_cast<__m128i *>(buf);
+      auto const z = _mm_setzero_si128();
+      for (size_t i = 0; i < len / sizeof(__m128i); i++) {
+        _mm_stream_si128(p + i, z);
+      }
+
+      // Visible before the watermark moves
+      _mm_sfence();
+      return;
+    }
+#endif
+
+    memset(buf, 0, len);
+  }
+
+  Log &log;
+  std::thread reclaim_thd;
+  moodycamel::BlockingReaderWriterQueue<Log::ReclaimRange> queue{16};
+
+  alignas(64) std::atomic<uint64_t> watermark;
+};
+}  // namespace dory
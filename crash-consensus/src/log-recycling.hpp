@@ -1,23 +1,42 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <vector>
 
+#include "config.hpp"
 #include "context.hpp"
 #include "message-identifier.hpp"
 
 namespace dory {
+/*Le log est un anneau (voir LogConfig::RingSegments). Le leader écrit une
+requête de recyclage juste avant d'entrer dans un nouveau segment, et une
+dernière pour revenir au début du log (wrap) :
+  - commit_up_to : tout ce qui précède la requête est commité,
+  - reclaim_up_to : position (Log::ringPosition) jusqu'à laquelle les
+    répliques peuvent remettre le log à zéro. C'est le commit_up_to de la
+    requête précédente, auquel tout le monde a répondu.
+Chaque réplique répond dès qu'elle a traité la requête, après avoir fini de
+remettre à zéro ce que demandait la requête d'avant. Avant la requête suivante,
+le leader attend toutes les réponses : le segment dans lequel il entre a donc
+déjà été remis à zéro partout, sans pause pour recycler le log.*/
 struct LogRecyclingRequest {
   int requestor;
   uint64_t request_id;
   uint64_t commit_up_to;
+  uint64_t reclaim_up_to;
+  bool wrap;
 
   LogRecyclingRequest() {}
 
-  LogRecyclingRequest(int requestor, uint64_t request_id, uint64_t commit_up_to)
+  LogRecyclingRequest(int requestor, uint64_t request_id, uint64_t commit_up_to,
+                      uint64_t reclaim_up_to, bool wrap)
       : requestor(requestor),
         request_id(request_id),
-        commit_up_to(commit_up_to) {}
+        commit_up_to(commit_up_to),
+        reclaim_up_to(reclaim_up_to),
+        wrap(wrap) {}
 };
 
 class LogRecycling {
@@ -30,43 +49,83 @@ class LogRecycling {
     modulo = Identifiers::maxID(c_ctx->my_id, c_ctx->remote_ids);
   }
 
-  LogRecyclingRequest generateRequest(uint64_t fuo) {
-    LogRecyclingRequest req(c_ctx->my_id, req_nr, fuo);
+  // `position` is the ring position of `fuo`
+  LogRecyclingRequest generateRequest(uint64_t fuo, uint64_t position,
+                                      bool wrap) {
+    LogRecyclingRequest req(c_ctx->my_id, req_nr, fuo, reclaimable, wrap);
     req_nr += modulo;
+    requested = position;
+    outstanding = true;
     return req;
   }
 
-  bool waitForReplies(/*Leader current_leader, std::atomic<Leader> &leader*/) {
+  // Whether the last request waits for replies
+  inline bool pending() const { return outstanding; }
+
+  // The replies to a previous leadership are lost, the first request of the
+  // new one is waited for right away
+  inline void forgetPending() {
+    outstanding = false;
+    timed_out = false;
+  }
+
+  // Whether a replica let the last request time out and still did not reply
+  inline bool unanswered() const { return outstanding && timed_out; }
+
+  // False if `leader` moves to another replica, or if a replica does not
+  // reply within ConsensusConfig::recyclingReplyTimeoutMs (it may have
+  // crashed: its part of the ring cannot be reused until it replies). The
+  // request stays pending. After a timeout, the next calls only check the
+  // replies and fail right away until every replica answered.
+  bool waitForReplies(std::atomic<Leader> &leader) {
+    if (!outstanding) {
+      return true;
+    }
+
     auto &slots = scratchpad.readLogRecyclingSlots();
     auto ids = c_ctx->remote_ids;
+    auto deadline =
+        std::chrono::steady_clock::now() +
+        std::chrono::milliseconds(ConsensusConfig::recyclingReplyTimeoutMs);
+    int loops = 0;
 
     while (true) {
-      int eliminated_one = -1;
-      for (int i = 0; i < static_cast<int>(ids.size()); i++) {
+      for (int i = 0; i < static_cast<int>(ids.size());) {
         auto pid = ids[i];
         uint64_t volatile *temp = reinterpret_cast<uint64_t *>(slots[pid]);
         uint64_t val = *temp;
 
         if (val + modulo == req_nr) {
-          eliminated_one = i;
-          break;
+          ids[i] = ids[ids.size() - 1];
+          ids.pop_back();
+        } else {
+          i++;
         }
       }
 
-      if (eliminated_one >= 0) {
-        ids[eliminated_one] = ids[ids.size() - 1];
-        ids.pop_back();
+      if (ids.empty()) {
+        outstanding = false;
+        timed_out = false;
+        reclaimable = requested;
+        return true;
+      }
 
-        if (ids.empty()) {
-          return true;
-        }
+      if (timed_out) {
+        return false;
       }
 
-      /*
-        if (leader.load().requester != current_leader.requester) {
+      loops += 1;
+      if (loops % 1024 == 0) {
+        loops = 0;
+        if (leader.load().requester != c_ctx->my_id) {
+          return false;
+        }
+
+        if (std::chrono::steady_clock::now() > deadline) {
+          timed_out = true;
           return false;
         }
-        */
+      }
     }
   }
 
@@ -76,6 +135,11 @@ class LogRecycling {
   ScratchpadMemory &scratchpad;
   uint64_t req_nr;
   int modulo;
+
+  bool outstanding = false;
+  bool timed_out = false;
+  uint64_t requested = 0;
+  uint64_t reclaimable = 0;
 };
 
 }  // namespace dory
\ No newline at end of file
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "log.hpp"
+
+namespace dory {
+/*Flux des entrées commitées du log, pour les garder (audit) ou pour les
+rejouer sur une autre réplique. Le flux est une suite de blocs : un
+RangeHeader, puis les entrées telles qu'elles sont dans le log (avec leur
+padding), écrites directement depuis la mémoire enregistrée par writev, sans
+copie intermédiaire. Chaque bloc se suffit à lui-même, donc plusieurs exports
+successifs dans le même fichier forment encore un flux valide.
+
+Les entrées sont numérotées comme dans LogIndex. Un export ne peut pas remonter
+plus loin que les entrées du tour courant qui ne sont pas encore récupérées.*/
+class LogStream {
+ public:
+  struct RangeHeader {
+    uint32_t magic;
+    uint16_t slot_field_size;  // The slot layout of the exporting replica
+    uint16_t alignment;
+    uint64_t position;   // Ring position (Log::ringPosition) of the range
+    uint64_t first_seq;  // Sequence number of its first entry
+    uint64_t entries;
+    uint64_t length;  // Bytes of entries that follow the header
+  };
+
+  static constexpr uint32_t Magic = 0x6d727473;  // "strm"
+
+  enum Status { Done, Collected, Reclaimed };
+
+  // The committed entries from `seq` on, contiguous in the log and at most
+  // `max_bytes` of them (at least one entry)
+  static Status collect(Log &log, uint64_t seq, size_t max_bytes,
+                        RangeHeader &range, uint8_t *&data) {
+    if (seq < log.firstIndexedSequence()) {
+      return Reclaimed;
+    }
+
+    auto fuo = log.headerFirstUndecidedOffset();
+    data = log.entryAt(seq);
+    if (data == nullptr) {
+      return seq < log.endIndexedSequence() ? Reclaimed : Done;
+    }
+
+    auto offset = static_cast<size_t>(data - log.headerPtr());
+    auto end = offset;
+    uint64_t entries = 0;
+
+    for (auto entry = data; entry != nullptr && end < fuo;
+         entry = log.entryAt(seq + entries)) {
+      // Only the index knows where the next lap begins
+      if (entry != log.headerPtr() + end) {
+        break;
+      }
+
+      auto next =
+          end + LogConfig::round_up_powerof2(ParsedSlot(entry).totalLength());
+      if (entries > 0 && next - offset > max_bytes) {
+        break;
+      }
+
+      end = next;
+      entries++;
+    }
+
+    if (entries == 0) {
+      return Done;
+    }
+
+    range = RangeHeader{Magic,
+                        static_cast<uint16_t>(LogConfig::SlotFieldSize),
+                        static_cast<uint16_t>(LogConfig::Alignment),
+                        log.ringPosition(offset),
+                        seq,
+                        entries,
+                        end - offset};
+    return Collected;
+  }
+
+  // Writes the range header and the entries in a single writev
+  static void write(int fd, RangeHeader const &range, uint8_t const *data) {
+    struct iovec iov[2];
+    iov[0].iov_base = const_cast<RangeHeader *>(&range);
+    iov[0].iov_len = sizeof(range);
+    iov[1].iov_base = const_cast<uint8_t *>(data);
+    iov[1].iov_len = range.length;
+
+    int idx = 0;
+    while (idx < 2) {
+      auto written = writev(fd, iov + idx, 2 - idx);
+      if (written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw std::runtime_error(std::string("Could not export the log: ") +
+                                 std::strerror(errno));
+      }
+
+      auto left = static_cast<size_t>(written);
+      while (idx < 2 && left >= iov[idx].iov_len) {
+        left -= iov[idx].iov_len;
+        idx++;
+      }
+
+      if (idx < 2) {
+        iov[idx].iov_base = static_cast<uint8_t *>(iov[idx].iov_base) + left;
+        iov[idx].iov_len -= left;
+      }
+    }
+  }
+
+  // Reads back what write() produced, one range at a time
+  class Reader {
+   public:
+    Reader(int fd) : fd{fd} {}
+
+    // False at the end of the stream
+    bool next(RangeHeader &range, uint8_t *&data) {
+      if (!read_fully(&range, sizeof(range), true)) {
+        return false;
+      }
+
+      if (range.magic != Magic) {
+        throw std::runtime_error("Not a log stream");
+      }
+
+      if (range.slot_field_size != LogConfig::SlotFieldSize ||
+          range.alignment != LogConfig::Alignment) {
+        throw std::runtime_error(
+            "The log stream comes from a replica with another slot layout");
+      }
+
+      // uint64_t words keep the entries aligned like in the log
+      buf.resize((range.length + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+      data = reinterpret_cast<uint8_t *>(buf.data());
+      read_fully(data, range.length, false);
+
+      return true;
+    }
+
+   private:
+    bool read_fully(void *dst, size_t len, bool eof_ok) {
+      auto p = static_cast<uint8_t *>(dst);
+      size_t done = 0;
+
+      while (done < len) {
+        auto n = read(fd, p + done, len - done);
+        if (n < 0) {
+          if (errno == EINTR) {
+            continue;
+          }
+          throw std::runtime_error(std::string("Could not import the log: ") +
+                                   std::strerror(errno));
+        }
+
+        if (n == 0) {
+          if (eof_ok && done == 0) {
+            return false;
+          }
+          throw std::runtime_error("The log stream is truncated");
+        }
+
+        done += static_cast<size_t>(n);
+      }
+
+      return true;
+    }
+
+    int fd;
+    std::vector<uint64_t> buf;
+  };
+};
+}  // namespace dory
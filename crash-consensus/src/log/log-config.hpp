@@ -1,8 +1,43 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 namespace dory {
 struct LogConfig {
+  // An entry is [length][acceptedProposal][firstUndecidedOffset][payload]
+  // [canary], where length counts the two fields after it and the payload.
+  // The three fields take 64 bits and entries are aligned on a cache line,
+  // unless built with DORY_COMPACT_SLOTS (conan option compact_slots): the
+  // fields then take 32 bits and entries are aligned on 8 bytes, an 8-byte
+  // command uses 24 bytes of log instead of 64. The log is limited to 2GiB in
+  // that case, and proposal numbers (that grow by the number of replicas at
+  // each leader change) to 32 bits.
+#ifdef DORY_COMPACT_SLOTS
+  using SlotField = uint32_t;
+  static constexpr int Alignment = 8;
+#else
+  using SlotField = uint64_t;
   static constexpr int Alignment = 64;
+#endif
+
+  static constexpr size_t SlotFieldSize = sizeof(SlotField);
+  static constexpr size_t SlotHeaderSize = 3 * SlotFieldSize;
+
+  // Header and canary of an entry with a `payload`-byte payload
+  static constexpr size_t entrySize(size_t payload) {
+    return SlotHeaderSize + payload + 1;
+  }
+
+  // Set in the firstUndecidedOffset field of entries whose payload packs
+  // several commands as length-prefixed sub-records. Log offsets never reach
+  // this bit.
+  static constexpr uint64_t BatchFlag = 1ULL << (8 * SlotFieldSize - 1);
+
+  // The entries form a ring split in RingSegments segments. Entering a
+  // segment requires the replicas to have zeroed what the previous lap left
+  // there, which they acknowledge a few segments in advance (see LogRecycling).
+  static constexpr size_t RingSegments = 8;
 
   static constexpr bool is_powerof2(size_t v) {
     return v && ((v & (v - 1)) == 0);
@@ -11,5 +46,9 @@ struct LogConfig {
   static constexpr size_t round_up_powerof2(size_t v) {
     return (v + Alignment - 1) & (-static_cast<ssize_t>(Alignment));
   }
+
+  static constexpr size_t round_down_powerof2(size_t v) {
+    return v & (-static_cast<ssize_t>(Alignment));
+  }
 };
 }  // namespace dory
\ No newline at end of file
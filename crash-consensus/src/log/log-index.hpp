@@ -0,0 +1,94 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "log-config.hpp"
+
+namespace dory {
+/*Index des entrées du tour courant du log : le i-ème élément est l'offset de
+la i-ème entrée, en unités de LogConfig::Alignment sur 32 bits. Il est rempli à
+mesure que les entrées arrivent dans le log local (voir Log::indexEntry), et
+remis à zéro à chaque tour. Le tableau est alloué une fois pour toutes (voir
+allocate), ajouter une entrée ne fait jamais grandir quoi que ce soit.
+
+Les numéros de séquence ne reviennent jamais en arrière : la première entrée
+d'un tour suit la dernière du tour précédent. Seul le propriétaire du log le
+modifie ou le lit.*/
+class LogIndex {
+ public:
+  LogIndex() : first_seq{0}, start{0}, end_offset{0}, count{0} {}
+
+  // Room for `capacity` entries per lap. The memory is left uninitialized, the
+  // pages are only faulted in as entries are indexed.
+  inline void allocate(size_t capacity) {
+    offsets.reset(new uint32_t[capacity]);
+    count = 0;
+  }
+
+  // The next entry to index starts at `offset`, the entries indexed so far
+  // are forgotten (new lap)
+  inline void restart(size_t offset) {
+    first_seq += count;
+    count = 0;
+    start = offset;
+    end_offset = offset;
+  }
+
+  inline uint64_t firstSequence() const { return first_seq; }
+  inline uint64_t endSequence() const { return first_seq + count; }
+
+  // Where the entry following the last indexed one starts
+  inline size_t end() const { return end_offset; }
+  inline size_t begin() const { return start; }
+
+  inline size_t offsetOf(uint64_t seq) const {
+    return static_cast<size_t>(offsets[seq - first_seq]) *
+           LogConfig::Alignment;
+  }
+
+  // Where the entry `seq` ends, the next one starts
+  inline size_t entryEnd(uint64_t seq) const {
+    return seq + 1 < endSequence() ? offsetOf(seq + 1) : end_offset;
+  }
+
+  inline void append(size_t offset, size_t next) {
+    offsets[count++] = static_cast<uint32_t>(offset / LogConfig::Alignment);
+    end_offset = next;
+  }
+
+  // Sequence number of the first entry that starts at or after `offset`
+  inline uint64_t lowerBound(size_t offset) const {
+    auto key = static_cast<uint32_t>((offset + LogConfig::Alignment - 1) /
+                                     LogConfig::Alignment);
+    auto it = std::lower_bound(offsets.get(), offsets.get() + count, key);
+    return first_seq + static_cast<uint64_t>(it - offsets.get());
+  }
+
+  // An indexed entry starts at `offset`, or the next one will
+  inline bool isBoundary(size_t offset) const {
+    if (offset == end_offset) {
+      return true;
+    }
+
+    auto seq = lowerBound(offset);
+    return seq < endSequence() && offsetOf(seq) == offset;
+  }
+
+  // Forgets the entries at and after `offset`, which is a boundary
+  inline void truncate(size_t offset) {
+    auto seq = lowerBound(offset);
+    count = static_cast<size_t>(seq - first_seq);
+    end_offset = offset;
+  }
+
+ private:
+  uint64_t first_seq;
+  size_t start;
+  size_t end_offset;
+  std::unique_ptr<uint32_t[]> offsets;
+  size_t count;  // Entries of the current lap
+};
+}  // namespace dory
@@ -6,8 +6,8 @@ SnapshotIterator::SnapshotIterator(uint8_t* entry_ptr, size_t length)
     : entry_ptr{entry_ptr}, end_ptr{entry_ptr + length} {}
 
 SnapshotIterator& SnapshotIterator::next() {
-  auto length = *reinterpret_cast<uint64_t*>(entry_ptr);
-  auto canary = entry_ptr + length + sizeof(uint64_t);
+  auto length = *reinterpret_cast<LogConfig::SlotField*>(entry_ptr);
+  auto canary = entry_ptr + length + LogConfig::SlotFieldSize;
 
   if (*canary != 0xff) {
     throw std::runtime_error("Missing canary value on the snapshot iterator");
@@ -26,12 +26,12 @@ BlockingIterator::BlockingIterator(uint8_t* entry_ptr)
 BlockingIterator& BlockingIterator::next() {
   entry_ptr += increment;
 
-  volatile auto length_ptr = reinterpret_cast<uint64_t*>(entry_ptr);
+  volatile auto length_ptr = reinterpret_cast<LogConfig::SlotField*>(entry_ptr);
   while (*length_ptr == 0) {
     ;
   }
 
-  volatile auto canary_ptr = entry_ptr + *length_ptr + sizeof(uint64_t);
+  volatile auto canary_ptr = entry_ptr + *length_ptr + LogConfig::SlotFieldSize;
   while (*canary_ptr == 0) {
     ;
   }
@@ -43,12 +43,12 @@ BlockingIterator& BlockingIterator::next() {
 bool BlockingIterator::sampleNext() {
   auto tmp_entry_ptr = entry_ptr + increment;
 
-  volatile auto length_ptr = reinterpret_cast<uint64_t*>(tmp_entry_ptr);
+  volatile auto length_ptr = reinterpret_cast<LogConfig::SlotField*>(tmp_entry_ptr);
   if (*length_ptr == 0) {
     return false;
   }
 
-  volatile auto canary_ptr = tmp_entry_ptr + *length_ptr + sizeof(uint64_t);
+  volatile auto canary_ptr = tmp_entry_ptr + *length_ptr + LogConfig::SlotFieldSize;
   if (*canary_ptr == 0) {
     return false;
   }
@@ -72,14 +72,14 @@ bool LiveIterator::hasNext(ptrdiff_t limit) {
 LiveIterator& LiveIterator::next(bool check) {
   entry_ptr += increment;
 
-  volatile auto length_ptr = reinterpret_cast<uint64_t*>(entry_ptr);
+  volatile auto length_ptr = reinterpret_cast<LogConfig::SlotField*>(entry_ptr);
   if (check) {
     while (*length_ptr == 0) {
       ;
     }
   }
 
-  volatile auto canary_ptr = entry_ptr + *length_ptr + sizeof(uint64_t);
+  volatile auto canary_ptr = entry_ptr + *length_ptr + LogConfig::SlotFieldSize;
   if (check) {
     while (*canary_ptr == 0) {
       ;
@@ -113,44 +113,44 @@ std::pair<ptrdiff_t, size_t> RemoteIterator::lookAt(uint64_t rem_offset) {
 }
 
 bool RemoteIterator::isPopulated(uint8_t* data, size_t length) {
-  if (length < sizeof(uint64_t)) {
+  if (length < LogConfig::SlotFieldSize) {
     throw std::runtime_error(
         "First make sure that you `canMove`, before calling "
         "`isEntryComplete`.");
   }
 
-  auto length_ptr = reinterpret_cast<uint64_t*>(data);
+  auto length_ptr = reinterpret_cast<LogConfig::SlotField*>(data);
   return *length_ptr != 0;
 }
 
 bool RemoteIterator::canMove(uint8_t* data, size_t length) {
-  auto length_ptr = reinterpret_cast<uint64_t*>(data);
+  auto length_ptr = reinterpret_cast<LogConfig::SlotField*>(data);
 
   // std::cout << "Length entry " << *length_ptr << std::endl;
 
-  if (*length_ptr + 1 + sizeof(uint64_t) <= length) {
+  if (*length_ptr + 1 + LogConfig::SlotFieldSize <= length) {
     // std::cout << "True: Adjusting the predictor to " << *length_ptr + 1 +
     // sizeof(uint64_t) << std::endl;
-    predictor.adjust(*length_ptr + 1 + sizeof(uint64_t));
+    predictor.adjust(*length_ptr + 1 + LogConfig::SlotFieldSize);
     return true;
   }
 
   // std::cout << "False: Adjusting the predictor to " << *length_ptr + 1 +
   // sizeof(uint64_t) << std::endl;
-  predictor.adjust(*length_ptr + 1 + sizeof(uint64_t));
+  predictor.adjust(*length_ptr + 1 + LogConfig::SlotFieldSize);
   return false;
 }
 
 bool RemoteIterator::isEntryComplete(uint8_t* data, size_t length) {
-  auto length_ptr = reinterpret_cast<uint64_t*>(data);
+  auto length_ptr = reinterpret_cast<LogConfig::SlotField*>(data);
 
-  if (*length_ptr + 1 + sizeof(uint64_t) > length) {
+  if (*length_ptr + 1 + LogConfig::SlotFieldSize > length) {
     throw std::runtime_error(
         "First make sure that you `canMove`, before calling "
         "`isEntryComplete`.");
   }
 
-  auto canary_ptr = data + *length_ptr + sizeof(uint64_t);
+  auto canary_ptr = data + *length_ptr + LogConfig::SlotFieldSize;
   return *canary_ptr != 0;
 }
 }  // namespace dory
\ No newline at end of file
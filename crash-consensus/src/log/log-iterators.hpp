@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <utility>
 
+#include "log-config.hpp"
 #include "log-helpers.hpp"
 
 namespace dory {
@@ -61,7 +62,7 @@ class LiveIterator {
 namespace dory {
 class RemoteIterator {
  public:
-  RemoteIterator(size_t entry_header_size = sizeof(uint64_t));
+  RemoteIterator(size_t entry_header_size = LogConfig::SlotFieldSize);
 
   RemoteIterator(int remote_id, size_t remote_offset, size_t entry_header_size);
 
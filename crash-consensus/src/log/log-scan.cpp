@@ -0,0 +1,162 @@
+#include "log-scan.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace dory {
+namespace scan {
+// The vector loops only test the accumulator every CheckEvery bytes
+static constexpr size_t CheckEvery = 4096;
+
+static bool is_zero_scalar(uint8_t const *buf, size_t len) {
+  size_t i = 0;
+  for (; i < len && (reinterpret_cast<uintptr_t>(buf + i) & 7) != 0; i++) {
+    if (buf[i] != 0) {
+      return false;
+    }
+  }
+
+  uint64_t acc = 0;
+  while (i + sizeof(uint64_t) <= len) {
+    auto block_end =
+        i + std::min((len - i) & ~(sizeof(uint64_t) - 1), CheckEvery);
+    for (; i < block_end; i += sizeof(uint64_t)) {
+      uint64_t word;
+      memcpy(&word, buf + i, sizeof(word));
+      acc |= word;
+    }
+
+    if (acc != 0) {
+      return false;
+    }
+  }
+
+  for (; i < len; i++) {
+    acc |= buf[i];
+  }
+
+  return acc == 0;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2"))) static bool is_zero_avx2(uint8_t const *buf,
+                                                         size_t len) {
+  size_t i = 0;
+  for (; i < len && (reinterpret_cast<uintptr_t>(buf + i) & 31) != 0; i++) {
+    if (buf[i] != 0) {
+      return false;
+    }
+  }
+
+  // The early exit counts from the first aligned byte, buf may start anywhere
+  size_t const start = i;
+
+  __m256i acc = _mm256_setzero_si256();
+  for (; i + 128 <= len; i += 128) {
+    auto p = reinterpret_cast<__m256i const *>(buf + i);
+    auto a = _mm256_or_si256(_mm256_load_si256(p), _mm256_load_si256(p + 1));
+    auto b =
+        _mm256_or_si256(_mm256_load_si256(p + 2), _mm256_load_si256(p + 3));
+    acc = _mm256_or_si256(acc, _mm256_or_si256(a, b));
+
+    if (((i + 128 - start) & (CheckEvery - 1)) == 0 &&
+        !_mm256_testz_si256(acc, acc)) {
+      return false;
+    }
+  }
+
+  if (!_mm256_testz_si256(acc, acc)) {
+    return false;
+  }
+
+  return is_zero_scalar(buf + i, len - i);
+}
+
+__attribute__((target("avx512f"))) static bool is_zero_avx512(
+    uint8_t const *buf, size_t len) {
+  size_t i = 0;
+  for (; i < len && (reinterpret_cast<uintptr_t>(buf + i) & 63) != 0; i++) {
+    if (buf[i] != 0) {
+      return false;
+    }
+  }
+
+  // Bytes since the first aligned one, as in is_zero_avx2
+  size_t const start = i;
+
+  __m512i acc = _mm512_setzero_si512();
+  for (; i + 256 <= len; i += 256) {
+    auto p = reinterpret_cast<__m512i const *>(buf + i);
+    auto a = _mm512_or_si512(_mm512_load_si512(p), _mm512_load_si512(p + 1));
+    auto b =
+        _mm512_or_si512(_mm512_load_si512(p + 2), _mm512_load_si512(p + 3));
+    acc = _mm512_or_si512(acc, _mm512_or_si512(a, b));
+
+    if (((i + 256 - start) & (CheckEvery - 1)) == 0 &&
+        _mm512_test_epi64_mask(acc, acc) != 0) {
+      return false;
+    }
+  }
+
+  if (_mm512_test_epi64_mask(acc, acc) != 0) {
+    return false;
+  }
+
+  return is_zero_scalar(buf + i, len - i);
+}
+#endif
+
+bool supported(Kernel k) {
+  switch (k) {
+    case Kernel::Scalar:
+      return true;
+#if defined(__x86_64__)
+    case Kernel::Avx2:
+      return __builtin_cpu_supports("avx2");
+    case Kernel::Avx512:
+      return __builtin_cpu_supports("avx512f");
+#endif
+    default:
+      return false;
+  }
+}
+
+Kernel best() {
+  static Kernel const k = supported(Kernel::Avx512)
+                              ? Kernel::Avx512
+                              : supported(Kernel::Avx2) ? Kernel::Avx2
+                                                        : Kernel::Scalar;
+  return k;
+}
+
+char const *name(Kernel k) {
+  switch (k) {
+    case Kernel::Avx2:
+      return "avx2";
+    case Kernel::Avx512:
+      return "avx512";
+    default:
+      return "scalar";
+  }
+}
+
+bool isZero(Kernel k, uint8_t const *buf, size_t len) {
+  switch (k) {
+#if defined(__x86_64__)
+    case Kernel::Avx2:
+      return is_zero_avx2(buf, len);
+    case Kernel::Avx512:
+      return is_zero_avx512(buf, len);
+#endif
+    default:
+      return is_zero_scalar(buf, len);
+  }
+}
+
+bool isZero(uint8_t const *buf, size_t len) { return isZero(best(), buf, len); }
+}  // namespace scan
+}  // namespace dory
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace dory {
+namespace scan {
+/*Noyaux de parcours de la mémoire du log. La version AVX-512 ou AVX2 est
+choisie à l'exécution (cpuid), avec une version scalaire sinon, pour que la
+librairie tourne sur toutes les machines sans être compilée pour une seule.*/
+enum class Kernel { Scalar, Avx2, Avx512 };
+
+// The fastest kernel the CPU supports, picked once
+Kernel best();
+char const *name(Kernel k);
+bool supported(Kernel k);
+
+bool isZero(uint8_t const *buf, size_t len);
+bool isZero(Kernel k, uint8_t const *buf, size_t len);
+}  // namespace scan
+}  // namespace dory
@@ -1,63 +1,16 @@
 #include "log.hpp"
+#include "log-scan.hpp"
 
 namespace dory {
 
-static bool is_zero(uint8_t *buf, size_t size) {
-  // For very small buffers, we do not optimize
-  if (size < 6 * sizeof(uint64_t)) {
-    for (size_t i = 0; i < size; i++) {
-      if (buf[i] != 0) {
-        return false;
-      }
-    }
-
-    return true;
-  }
-
-  // For larger buffers, we are guaranteed to be able to find an aligned segment
-  // in the provided buffer. We use memcmp for this segment.
-
-  // Get aligned start
-  uint8_t *aligned_buf =
-      reinterpret_cast<uint8_t *>((uintptr_t(buf) + sizeof(uint64_t) - 1) /
-                                  sizeof(uint64_t) * sizeof(uint64_t));
-
-  size_t unaligned_start_len = uintptr_t(aligned_buf) - uintptr_t(buf);
-  size_t aligned_len =
-      (size - unaligned_start_len) / sizeof(uint64_t) * sizeof(uint64_t);
-
-  // Check unaligned start
-  for (size_t i = 0; i < unaligned_start_len; i++) {
-    if (buf[i] != 0) {
-      return false;
-    }
-  }
-
-  // Check unaligned end
-  for (size_t i = unaligned_start_len + aligned_len; i < size; i++) {
-    if (buf[i] != 0) {
-      return false;
-    }
-  }
-
-  // For this to work, we need an aligned buffer of at least 2 *
-  // sizeof(uint64_t) bytes
-  return *reinterpret_cast<uint64_t *>(aligned_buf) == 0 ||
-         memcmp(aligned_buf, aligned_buf + sizeof(uint64_t),
-                aligned_len - sizeof(uint64_t)) == 0;
-}
-
-Log::Log(void *underlying_buf, size_t buf_len)
+Log::Log(void *underlying_buf, size_t buf_len, bool resume, bool zeroed)
     : buf{reinterpret_cast<uint8_t *>(underlying_buf)}, len{buf_len} {
   static_assert(LogConfig::is_powerof2(LogConfig::Alignment),
                 "should use a power of 2 as template parameter");
+  static_assert(sizeof(LogHeader) <= 64,
+                "The header must not push back the entries");
 
   auto buf_addr = reinterpret_cast<uintptr_t>(underlying_buf);
-
-  if (!is_zero(buf, buf_len)) {
-    throw std::runtime_error("Provided buffer is not zeroed out");
-  }
-
   auto offset = LogConfig::round_up_powerof2(buf_addr) - buf_addr;
   // std::cout << "Rounding up: " << round_up_powerof2(buf_addr) << " " <<
   // buf_addr << std::endl;
@@ -71,8 +24,25 @@ Log::Log(void *underlying_buf, size_t buf_len)
   buf += offset;
   len -= offset;
 
+  // Offsets have to fit in the FUO field of the entries, below the batch flag
+  if (len > LogConfig::BatchFlag) {
+    throw std::runtime_error("The log is too large for its slot encoding");
+  }
+
   header = reinterpret_cast<LogHeader *>(buf);
-  header->min_proposal = 0;
+  was_resumed = resume && header->magic == HeaderMagic;
+
+  if (!was_resumed && !zeroed &&
+      !scan::isZero(reinterpret_cast<uint8_t *>(underlying_buf), buf_len)) {
+    throw std::runtime_error("Provided buffer is not zeroed out");
+  }
+
+  // The proposal, the FUO and the lap survive, the rest is recomputed below
+  auto resumed_fuo = header->first_undecided_offset;
+  if (!was_resumed) {
+    header->min_proposal = 0;
+    header->lap = 0;
+  }
   header->first_undecided_offset = 0;
   header->free_bytes = len - LogConfig::round_up_powerof2(sizeof(LogHeader));
 
@@ -90,17 +60,229 @@ Log::Log(void *underlying_buf, size_t buf_len)
   initial_fuo = len - header->free_bytes;
   initial_free_bytes = header->free_bytes;
   header->first_undecided_offset = initial_fuo;
+
+  segment_len = LogConfig::round_down_powerof2(initial_free_bytes /
+                                               LogConfig::RingSegments);
+  if (segment_len < 2 * constants::CRITICAL_LOG_FREE_SPACE) {
+    throw std::runtime_error("The log is too small for its ring segments");
+  }
+
+  enterSegment(0);
+  reclaim_target = initial_fuo;
+
+  if (was_resumed) {
+    resume_from(resumed_fuo);
+  }
+
+  header->magic = HeaderMagic;
+}
+
+void Log::resume_from(size_t fuo) {
+  lap = header->lap;
+  fuo = std::max(fuo, initial_fuo);
+  header->first_undecided_offset = fuo;
+
+  // The entries past the FUO were accepted but not committed, they are kept,
+  // up to the first one the crash left incomplete
+  auto tail = walk_entries(fuo, len, false);
+  header->free_bytes = len - tail;
+
+  // Past the tail, only leftovers of the previous lap (not zeroed yet, or
+  // torn by the crash)
+  memset(buf + tail, 0, len - tail);
+
+  enterSegment(std::min((tail - initial_fuo) / segment_len,
+                        LogConfig::RingSegments - 1));
+  reclaim_target = ringPosition(initial_fuo);
+}
+
+void Log::enterSegment(size_t segment) {
+  if (segment + 1 < LogConfig::RingSegments) {
+    ring_boundary = initial_fuo + (segment + 1) * segment_len -
+                    constants::CRITICAL_LOG_FREE_SPACE;
+  } else {
+    // Only spaceLeftCritical() ends the last segment
+    ring_boundary = len;
+  }
+}
+
+void Log::wrap(size_t lap_end) {
+  prev_lap_end = lap_end;
+  lap++;
+  header->lap = lap;
+
+  resetFUO();
+  if (index_enabled) {
+    index.restart(initial_fuo);
+  }
+  rebuildLog();
+  enterSegment(0);
+}
+
+void Log::rebuildLog() {
+  auto fuo = headerFirstUndecidedOffset();
+
+  if (!index_enabled) {
+    header->free_bytes = len - walk_entries(fuo, len, false);
+    return;
+  }
+
+  // What the index has past the FUO was checked when it got indexed
+  if (!index.isBoundary(fuo)) {
+    index.restart(fuo);
+  } else if (!indexed_tail_intact()) {
+    index.truncate(fuo);
+  }
+
+  index_up_to(len);
+  header->free_bytes = len - index.end();
+}
+
+void Log::enableIndex() {
+  if (len / LogConfig::Alignment > UINT32_MAX) {
+    throw std::runtime_error("The log is too large to be indexed");
+  }
+
+  // A lap holds at most one entry of the smallest size every that many bytes
+  index.allocate(len / LogConfig::round_up_powerof2(LogConfig::entrySize(0)));
+  index_enabled = true;
+  index.restart(headerFirstUndecidedOffset());
+  index_up_to(tailOffset());
+}
+
+void Log::indexEntry(uint8_t *entry) {
+  if (!index_enabled) {
+    return;
+  }
+
+  auto offset = static_cast<size_t>(entry - buf);
+  auto next =
+      offset + LogConfig::round_up_powerof2(ParsedSlot(entry).totalLength());
+
+  if (offset < index.end()) {
+    if (!index.isBoundary(offset)) {
+      index.restart(offset);
+    } else if (index.entryEnd(index.lowerBound(offset)) == next) {
+      return;  // Indexed already (by rebuildLog)
+    } else {
+      index.truncate(offset);  // Rewritten by a new leader
+    }
+  }
+
+  // Entries that reached the log without being seen here (catch-up)
+  index_up_to(offset);
+  if (index.end() != offset) {
+    index.restart(offset);
+  }
+
+  index.append(offset, next);
+}
+
+uint8_t *Log::entryAt(uint64_t seq) {
+  if (!index_enabled || seq < index.firstSequence() ||
+      seq >= index.endSequence()) {
+    return nullptr;
+  }
+
+  auto offset = index.offsetOf(seq);
+  if (ringPosition(offset) < reclaim_target) {
+    return nullptr;
+  }
+
+  return buf + offset;
+}
+
+void Log::index_up_to(size_t limit) {
+  walk_entries(index.end(), limit, true);
+}
+
+size_t Log::walk_entries(size_t offset, size_t limit, bool index_them) {
+  // Every length depends on the previous entry, so the walk stays serial. It
+  // stops at the first hole or at the first entry without its canary.
+  while (offset < limit && offset + LogConfig::SlotFieldSize <= len) {
+    ParsedSlot pslot(buf + offset);
+    if (!pslot.isPopulated()) {
+      break;
+    }
+
+    auto total = pslot.totalLength();
+    if (total > len - offset || buf[offset + total - 1] == 0) {
+      break;
+    }
+
+    auto next = offset + LogConfig::round_up_powerof2(total);
+    if (index_them) {
+      index.append(offset, next);
+    }
+    offset = next;
+  }
+
+  return offset;
+}
+
+bool Log::indexed_tail_intact() {
+  if (index.endSequence() == index.firstSequence()) {
+    return true;
+  }
+
+  auto last = index.endSequence() - 1;
+  auto offset = index.offsetOf(last);
+  ParsedSlot pslot(buf + offset);
+  if (!pslot.isPopulated()) {
+    return false;
+  }
+
+  auto total = pslot.totalLength();
+  return offset + LogConfig::round_up_powerof2(total) == index.end() &&
+         total <= len - offset && buf[offset + total - 1] != 0;
+}
+
+std::vector<Log::ReclaimRange> Log::reclaimUpTo(uint64_t position) {
+  std::vector<ReclaimRange> ranges;
+  if (position <= reclaim_target) {
+    return ranges;
+  }
+
+  auto from_lap = reclaim_target / len;
+  auto from = reclaim_target % len;
+
+  if (from_lap + 1 == lap) {
+    auto to = position / len == from_lap ? position % len : prev_lap_end;
+    if (to > from) {
+      ranges.push_back(ReclaimRange{headerPtr() + from, to - from,
+                                    reclaim_target});
+    }
+
+    if (position / len == from_lap) {
+      reclaim_target = position;
+      return ranges;
+    }
+
+    from_lap = lap;
+    from = initial_fuo;
+  }
+
+  if (from_lap != lap || position / len != lap) {
+    throw std::runtime_error(
+        "Coding bug: the log reclaims entries from an older lap");
+  }
+
+  ranges.push_back(ReclaimRange{headerPtr() + from, position % len - from,
+                                ringPosition(from)});
+  reclaim_target = position;
+  return ranges;
 }
 
 Log::Entry Log::newEntry() {
   // std::cout << "Adding entry with absolute offset " << len -
   // header->free_bytes << std::endl;
-  return Entry(buf + len - header->free_bytes, header->free_bytes);
+  return Entry(nextEntryPtr(), header->free_bytes);
 }
 
 void Log::finalizeEntry(Entry &entry) {
   auto bytes_used = entry.finalize();
   header->free_bytes -= LogConfig::round_up_powerof2(bytes_used);
+  indexEntry(entry.basePtr());
 }
 
 std::vector<uint8_t> Log::dump() const {
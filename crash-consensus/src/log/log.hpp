@@ -1,5 +1,7 @@
 #pragma once
 
+#include <sys/uio.h>
+#include <algorithm>
 #include <cstring>
 #include <memory>
 #include <vector>
@@ -12,40 +14,80 @@
 #include "log-config.hpp"
 #include "log-constants.hpp"
 #include "log-helpers.hpp"
+#include "log-index.hpp"
 #include "log-iterators.hpp"
 
 namespace dory {
 class ParsedSlot {
  public:
+  using BatchRecordLength = uint32_t;
+  using Field = LogConfig::SlotField;
+
   ParsedSlot(uint8_t* ptr) : ptr{ptr} {}
 
-  inline uint64_t acceptedProposal() {
-    return *reinterpret_cast<uint64_t*>(ptr + offsets[1]);
-  }
+  inline uint64_t acceptedProposal() { return field(1); }
 
   inline void setAcceptedProposal(uint64_t proposal) {
-    *reinterpret_cast<uint64_t*>(ptr + offsets[1]) = proposal;
+    *reinterpret_cast<Field*>(ptr + offsets[1]) = static_cast<Field>(proposal);
   }
 
   inline uint64_t firstUndecidedOffset() {
-    return *reinterpret_cast<uint64_t*>(ptr + offsets[2]);
+    return field(2) & ~LogConfig::BatchFlag;
   }
 
+  inline bool isBatch() { return (field(2) & LogConfig::BatchFlag) != 0; }
+
+  // Entries with a FUO of 0 carry a LogRecyclingRequest, not a command
+  inline bool isRecyclingRequest() { return field(2) == 0; }
+
   inline std::pair<uint8_t*, size_t> payload() {
-    auto length = *reinterpret_cast<uint64_t*>(ptr + offsets[0]) - 2 * sizeof(uint64_t);
+    auto length = field(0) - 2 * LogConfig::SlotFieldSize;
     auto buf = ptr + offsets[3];
     return std::make_pair(buf, length);
   }
 
-  inline bool isPopulated() { return *reinterpret_cast<uint64_t*>(ptr) > 0; }
+  // Calls `f(buf, len)` for every command stored in the entry: once for a
+  // plain entry, once per sub-record for a batched one, never for a recycling
+  // request.
+  template <typename Func>
+  inline void forEachRecord(Func&& f) {
+    if (isRecyclingRequest()) {
+      return;
+    }
+
+    auto [buf, length] = payload();
+
+    if (!isBatch()) {
+      f(buf, length);
+      return;
+    }
+
+    auto end = buf + length;
+    while (buf < end) {
+      auto record_len = *reinterpret_cast<BatchRecordLength*>(buf);
+      buf += sizeof(BatchRecordLength);
+      f(buf, static_cast<size_t>(record_len));
+      buf += record_len;
+    }
+  }
+
+  static inline size_t batchPayloadSize(
+      std::vector<std::pair<uint8_t*, size_t>> const& records) {
+    size_t size = 0;
+    for (auto const& [buf, len] : records) {
+      size += sizeof(BatchRecordLength) + len;
+    }
+    return size;
+  }
+
+  inline bool isPopulated() { return field(0) > 0; }
 
   inline size_t totalLength() {
-    return *reinterpret_cast<uint64_t*>(ptr) + sizeof(uint64_t) + 1;
+    return field(0) + LogConfig::SlotFieldSize + 1;
   }
 
   static inline size_t copy(uint8_t* dst, uint8_t* src) {
-    auto src_len = *reinterpret_cast<uint64_t*>(src);
-    auto size = src_len + 1 + sizeof(uint64_t);
+    auto size = ParsedSlot(src).totalLength();
     if (src != dst) {
       memcpy(dst, src, size);
     }
@@ -54,11 +96,15 @@ class ParsedSlot {
   }
 
  private:
+  inline uint64_t field(int i) {
+    return *reinterpret_cast<Field*>(ptr + offsets[i]);
+  }
+
   static constexpr const int offsets[] = {
-      0,   // For the length of the entry,
-      8,   // For the acceptedProposal,
-      16,  // For the firstUndecidedOffset,
-      24   // For the buffer
+      0,                  // For the length of the entry,
+      sizeof(Field),      // For the acceptedProposal,
+      2 * sizeof(Field),  // For the firstUndecidedOffset,
+      3 * sizeof(Field)   // For the buffer
   };
 
   uint8_t* ptr;
@@ -66,13 +112,34 @@ class ParsedSlot {
 
 class Log {
  public:
+  // A payload that the application already serialized at the position it will
+  // occupy in the entry, so storing it only moves the cursor (no memcpy).
+  struct InPlacePayload {
+    uint8_t* buf;
+    size_t len;
+  };
+
+  // A payload scattered over several application buffers (writev-style)
+  struct GatherPayload {
+    struct iovec const* iov;
+    int iovcnt;
+
+    inline size_t size() const {
+      size_t total = 0;
+      for (int i = 0; i < iovcnt; i++) {
+        total += iov[i].iov_len;
+      }
+      return total;
+    }
+  };
+
   class Entry {
    public:
     Entry() {}
 
     Entry(uint8_t* start, size_t remaining_space)
         : base{start},
-          start{start + sizeof(uint64_t)},
+          start{start + LogConfig::SlotFieldSize},
           space{remaining_space},
           len{0} {}
 
@@ -80,11 +147,7 @@ class Log {
                            size_t buf_len) {
       auto temp = start;
 
-      *reinterpret_cast<uint64_t*>(start) = x;
-      start += sizeof(x);
-
-      *reinterpret_cast<uint64_t*>(start) = y;
-      start += sizeof(y);
+      store_header(x, y);
 
       memcpy(start, buf, buf_len);
       start += buf_len;
@@ -92,14 +155,50 @@ class Log {
       len += start - temp;
     }
 
-    inline void store_uint64(uint64_t const& x) {
-      if (len + sizeof(x) > space) {
+    inline void fast_store_batch(
+        uint64_t const x, uint64_t const y,
+        std::vector<std::pair<uint8_t*, size_t>> const& records) {
+      auto temp = start;
+
+      store_header(x, y | LogConfig::BatchFlag);
+
+      store_records(records);
+
+      len += start - temp;
+    }
+
+    inline void fast_store_in_place(uint64_t const x, uint64_t const y,
+                                    InPlacePayload const& p) {
+      check_in_place(p, start + 2 * LogConfig::SlotFieldSize);
+      auto temp = start;
+
+      store_header(x, y);
+
+      start += p.len;
+
+      len += start - temp;
+    }
+
+    inline void fast_store_gather(uint64_t const x, uint64_t const y,
+                                  GatherPayload const& p) {
+      auto temp = start;
+
+      store_header(x, y);
+
+      gather(p);
+
+      len += start - temp;
+    }
+
+    inline void store_field(uint64_t const& x) {
+      if (len + LogConfig::SlotFieldSize > space) {
         throw std::runtime_error("Log ran out of space. Entry cannot fit.");
       }
 
-      *reinterpret_cast<uint64_t*>(start) = x;
-      start += sizeof(x);
-      len += sizeof(x);
+      *reinterpret_cast<LogConfig::SlotField*>(start) =
+          static_cast<LogConfig::SlotField>(x);
+      start += LogConfig::SlotFieldSize;
+      len += LogConfig::SlotFieldSize;
     }
 
     inline void store_buf(const void* buf, size_t length) {
@@ -112,21 +211,98 @@ class Log {
       len += length;
     }
 
+    inline void store_batch(
+        std::vector<std::pair<uint8_t*, size_t>> const& records) {
+      auto length = ParsedSlot::batchPayloadSize(records);
+      if (len + length > space) {
+        throw std::runtime_error("Log ran out of space. Entry cannot fit.");
+      }
+
+      // The firstUndecidedOffset is the last header field stored before the
+      // payload. Flag it so that readers unpack the sub-records.
+      *reinterpret_cast<LogConfig::SlotField*>(
+          start - LogConfig::SlotFieldSize) |= LogConfig::BatchFlag;
+
+      auto temp = start;
+      store_records(records);
+      len += start - temp;
+    }
+
+    inline void store_gather(GatherPayload const& p) {
+      if (len + p.size() > space) {
+        throw std::runtime_error("Log ran out of space. Entry cannot fit.");
+      }
+
+      auto temp = start;
+      gather(p);
+      len += start - temp;
+    }
+
+    inline void store_in_place(InPlacePayload const& p) {
+      if (len + p.len > space) {
+        throw std::runtime_error("Log ran out of space. Entry cannot fit.");
+      }
+
+      check_in_place(p, start);
+      start += p.len;
+      len += p.len;
+    }
+
     inline size_t finalize() {
-      auto length = reinterpret_cast<uint64_t*>(start - len - sizeof(uint64_t));
-      *length = len;
+      auto length = reinterpret_cast<LogConfig::SlotField*>(
+          start - len - LogConfig::SlotFieldSize);
+      *length = static_cast<LogConfig::SlotField>(len);
       *start = 0xff;
 
-      // The +1 is for the canary value, the uint64_t is because we encode the
+      // The +1 is for the canary value, the SlotField is because we encode
       // the length.
-      return *length + 1 + sizeof(uint64_t);
+      return len + 1 + LogConfig::SlotFieldSize;
     }
 
     inline uint8_t* basePtr() const { return base; }
 
-    inline size_t length() const { return len + 1 + sizeof(uint64_t); }
+    inline size_t length() const {
+      return len + 1 + LogConfig::SlotFieldSize;
+    }
 
    private:
+    inline void store_header(uint64_t const x, uint64_t const y) {
+      *reinterpret_cast<LogConfig::SlotField*>(start) =
+          static_cast<LogConfig::SlotField>(x);
+      start += LogConfig::SlotFieldSize;
+
+      *reinterpret_cast<LogConfig::SlotField*>(start) =
+          static_cast<LogConfig::SlotField>(y);
+      start += LogConfig::SlotFieldSize;
+    }
+
+    inline void gather(GatherPayload const& p) {
+      for (int i = 0; i < p.iovcnt; i++) {
+        memcpy(start, p.iov[i].iov_base, p.iov[i].iov_len);
+        start += p.iov[i].iov_len;
+      }
+    }
+
+    static inline void check_in_place(InPlacePayload const& p,
+                                      uint8_t* expected) {
+      if (p.buf != expected) {
+        throw std::runtime_error(
+            "In-place payload is not located where the entry expects it");
+      }
+    }
+
+    inline void store_records(
+        std::vector<std::pair<uint8_t*, size_t>> const& records) {
+      for (auto const& [buf, buf_len] : records) {
+        *reinterpret_cast<ParsedSlot::BatchRecordLength*>(start) =
+            static_cast<ParsedSlot::BatchRecordLength>(buf_len);
+        start += sizeof(ParsedSlot::BatchRecordLength);
+
+        memcpy(start, buf, buf_len);
+        start += buf_len;
+      }
+    }
+
     uint8_t* base;
     uint8_t* start;
     uint64_t space;
@@ -137,15 +313,26 @@ class Log {
     uint64_t min_proposal;
     uint64_t first_undecided_offset;
     uint64_t free_bytes;
+
+    // Only used when the log outlives the process (durable log)
+    uint64_t lap;
+    uint64_t magic;
   };
 
+  static constexpr uint64_t HeaderMagic = 0x31676f6c79726f64ULL;  // "dorylog1"
+
   enum Offsets {
     MinProposal = 0,
     FUO = 1,
     Entries = 2,
   };
 
-  Log(void* underlying_buf, size_t buf_len);
+  // With `resume`, a buffer that already holds a log (durable log) is taken
+  // as is: the log continues from the FUO of its header. Anything else must
+  // be zeroed, which is checked unless the caller vouches for it with
+  // `zeroed` (e.g. a fresh anonymous mapping).
+  Log(void* underlying_buf, size_t buf_len, bool resume = false,
+      bool zeroed = false);
 
   // Copy constructor
   Log(Log const& other) = delete;
@@ -170,6 +357,9 @@ class Log {
     return offsets[off];
   }
 
+  // Where newEntry() will place the next entry
+  inline uint8_t* nextEntryPtr() const { return buf + len - header->free_bytes; }
+
   Entry newEntry();
   void finalizeEntry(Entry& entry);
 
@@ -188,23 +378,27 @@ class Log {
     return *off;
   }
 
-  inline void rebuildLog() volatile {
-    auto fuo = headerFirstUndecidedOffset();
-
-    header->free_bytes = len - fuo;
-    auto offset = reinterpret_cast<uint8_t*>(header) + fuo;
-
-    while (true) {
-      ParsedSlot pslot(offset);
-      if (pslot.isPopulated()) {
-        auto bytes_used = LogConfig::round_up_powerof2(pslot.totalLength());
-        offset += bytes_used;
-        header->free_bytes -= bytes_used;
-      } else {
-        break;
-      }
-    }
+  // Finds the tail again after the log changed owner, from the FUO. With the
+  // index, only what follows the last indexed entry is scanned.
+  void rebuildLog();
+
+  // Keeps an index of the entries of the current lap, starting with those
+  // that follow the FUO
+  void enableIndex();
+  inline bool indexed() const { return index_enabled; }
+
+  // The entry at `entry` is in the local log (appended by the leader, or
+  // discovered by a follower)
+  void indexEntry(uint8_t* entry);
+
+  // Entries are numbered in the order they reach the log, from
+  // enableIndex(). Only those of the current lap that are not reclaimed yet
+  // can be found: returns nullptr for the others.
+  uint8_t* entryAt(uint64_t seq);
+  inline uint64_t firstIndexedSequence() const {
+    return index.firstSequence();
   }
+  inline uint64_t endIndexedSequence() const { return index.endSequence(); }
 
   inline size_t spaceLeft() { return header->free_bytes; }
 
@@ -214,10 +408,56 @@ class Log {
 
   inline void resetFUO() { header->first_undecided_offset = initial_fuo; }
 
-  inline void bzero() {
-    memset(headerPtr() + initial_fuo, 0, initial_free_bytes);
+  // Offset of the entry newEntry() will create
+  inline size_t tailOffset() const { return len - header->free_bytes; }
+
+  // The leader has to send a recycling request before writing past the
+  // current segment, or before wrapping around when the lap is over
+  inline bool ringBoundaryReached() {
+    return tailOffset() >= ring_boundary || spaceLeftCritical();
+  }
+
+  // The segment a recycling request written at `offset` opens. The request
+  // comes CRITICAL_LOG_FREE_SPACE bytes ahead of the segment, the entries
+  // written before the next one may spill that far.
+  inline size_t segmentOf(size_t offset) const {
+    auto s = (offset + constants::CRITICAL_LOG_FREE_SPACE - initial_fuo) /
+             segment_len;
+    return std::min(s, LogConfig::RingSegments - 1);
+  }
+
+  void enterSegment(size_t segment);
+
+  // Goes back to the beginning of the log once the request closing the lap,
+  // which ends at `lap_end`, got written (leader) or read (follower).
+  void wrap(size_t lap_end);
+
+  // Offsets are reused at every lap, positions are not
+  inline uint64_t ringPosition(uint64_t offset) const {
+    return lap * len + offset;
   }
 
+  inline size_t length() const { return len; }
+  inline size_t firstEntryOffset() const { return initial_fuo; }
+  inline size_t previousLapEnd() const { return prev_lap_end; }
+
+  // The log found in the buffer was resumed rather than created
+  inline bool resumed() const { return was_resumed; }
+
+  // A part of the log to zero, `position` is the ring position of `ptr`
+  struct ReclaimRange {
+    uint8_t* ptr;
+    size_t len;
+    uint64_t position;
+  };
+
+  // Everything that precedes `position` can be zeroed. Returns what lies
+  // between the previous target and this one (the end of the previous lap
+  // first), the caller zeroes it.
+  std::vector<ReclaimRange> reclaimUpTo(uint64_t position);
+
+  inline uint64_t reclaimTarget() const { return reclaim_target; }
+
   // inline uint8_t* firstUndecidedOffsetEntry() volatile {
   //   return reinterpret_cast<uint8_t*>(header) + headerFirstUndecidedOffset();
   // }
@@ -248,21 +488,37 @@ class Log {
 
   RemoteIterator remoteIterator(int remote_id, uintptr_t offset = 0) {
     if (offset > 0) {
-      return RemoteIterator(remote_id, offset, sizeof(uint64_t));
+      return RemoteIterator(remote_id, offset, LogConfig::SlotFieldSize);
     }
 
     return RemoteIterator(remote_id,
                           LogConfig::round_up_powerof2(sizeof(LogHeader)),
-                          sizeof(uint64_t));
+                          LogConfig::SlotFieldSize);
   }
 
   std::vector<uint8_t> dump() const;
 
  private:
+  void resume_from(size_t fuo);
+  void index_up_to(size_t limit);
+  // Where the complete entries that follow `offset` end, at or past `limit`
+  size_t walk_entries(size_t offset, size_t limit, bool index_them);
+  bool indexed_tail_intact();
+
   size_t initial_fuo;
   size_t initial_free_bytes;
   uint8_t* buf;
   size_t len;
+
+  // Ring bookkeeping
+  size_t segment_len;
+  size_t ring_boundary;
+  uint64_t lap = 0;
+  size_t prev_lap_end = 0;
+  uint64_t reclaim_target;
+  bool was_resumed = false;
+  bool index_enabled = false;
+  LogIndex index;
   LogHeader* header;
   std::array<std::pair<ptrdiff_t, size_t>, 3> offsets;
 };
@@ -279,14 +535,38 @@ class Slot {
     log.finalizeEntry(entry);
   }
 
+  Slot(Log& log, uint64_t proposal_nr, uint64_t fuo,
+       std::vector<std::pair<uint8_t*, size_t>> const& records)
+      : log{log} {
+    entry = log.newEntry();
+    entry.fast_store_batch(proposal_nr, fuo, records);
+    log.finalizeEntry(entry);
+  }
+
+  Slot(Log& log, uint64_t proposal_nr, uint64_t fuo,
+       Log::InPlacePayload const& payload)
+      : log{log} {
+    entry = log.newEntry();
+    entry.fast_store_in_place(proposal_nr, fuo, payload);
+    log.finalizeEntry(entry);
+  }
+
+  Slot(Log& log, uint64_t proposal_nr, uint64_t fuo,
+       Log::GatherPayload const& payload)
+      : log{log} {
+    entry = log.newEntry();
+    entry.fast_store_gather(proposal_nr, fuo, payload);
+    log.finalizeEntry(entry);
+  }
+
   inline void storeAcceptedProposal(uint64_t proposal) {
     check_sequence(0);
-    entry.store_uint64(proposal);
+    entry.store_field(proposal);
   }
 
   inline void storeFirstUndecidedOffset(uint64_t fuo) {
     check_sequence(1);
-    entry.store_uint64(fuo);
+    entry.store_field(fuo);
   }
 
   inline void storePayload(const uint8_t* buf, size_t len) {
@@ -295,6 +575,25 @@ class Slot {
     log.finalizeEntry(entry);
   }
 
+  inline void storePayload(
+      std::vector<std::pair<uint8_t*, size_t>> const& records) {
+    check_sequence(2);
+    entry.store_batch(records);
+    log.finalizeEntry(entry);
+  }
+
+  inline void storePayload(Log::GatherPayload const& payload) {
+    check_sequence(2);
+    entry.store_gather(payload);
+    log.finalizeEntry(entry);
+  }
+
+  inline void storePayload(Log::InPlacePayload const& payload) {
+    check_sequence(2);
+    entry.store_in_place(payload);
+    log.finalizeEntry(entry);
+  }
+
   inline ParsedSlot toParsedSlot() const { return ParsedSlot(entry.basePtr()); }
 
   std::tuple<uint8_t*, ptrdiff_t, size_t> location() const {
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+// Older C libraries do not know them yet
+#ifndef MAP_SHARED_VALIDATE
+#define MAP_SHARED_VALIDATE 0x03
+#endif
+
+#ifndef MAP_SYNC
+#define MAP_SYNC 0x80000
+#endif
+
+namespace dory {
+/*Mapping partagé d'un fichier (tmpfs, ext4, ...) ou d'un device DAX, qui
+remplace le buffer volatile du log. Sur un device DAX (ou un fichier sur un
+système de fichiers monté avec -o dax), MAP_SYNC garantit qu'il suffit de
+vider les lignes de cache (clwb) pour rendre les écritures durables. Sinon il
+faut passer par msync (voir LogFlusher).*/
+class MappedFile {
+ public:
+  MappedFile(std::string const &path, size_t length) : length{length} {
+    fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd == -1) {
+      throw std::runtime_error("Could not open " + path + ": " +
+                               std::strerror(errno));
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      close(fd);
+      throw std::runtime_error("Could not stat " + path + ": " +
+                               std::strerror(errno));
+    }
+
+    // Devices have a fixed size, regular files grow (with zeroes) if needed
+    if (S_ISREG(st.st_mode)) {
+      if (st.st_size != 0 && static_cast<size_t>(st.st_size) != length) {
+        close(fd);
+        throw std::runtime_error(path + " does not hold a log of " +
+                                 std::to_string(length) + " bytes");
+      }
+
+      if (st.st_size == 0 && ftruncate(fd, static_cast<off_t>(length)) != 0) {
+        close(fd);
+        throw std::runtime_error("Could not resize " + path + ": " +
+                                 std::strerror(errno));
+      }
+    }
+
+    void *mem = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                     MAP_SHARED_VALIDATE | MAP_SYNC, fd, 0);
+    sync_mapping = mem != MAP_FAILED;
+
+    if (!sync_mapping) {
+      mem = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+
+    if (mem == MAP_FAILED) {
+      close(fd);
+      throw std::runtime_error("Could not map " + path + ": " +
+                               std::strerror(errno));
+    }
+
+    buf = reinterpret_cast<uint8_t *>(mem);
+  }
+
+  ~MappedFile() {
+    munmap(buf, length);
+    close(fd);
+  }
+
+  MappedFile(MappedFile const &) = delete;
+  MappedFile &operator=(MappedFile const &) = delete;
+
+  inline uint8_t *data() { return buf; }
+  inline size_t size() const { return length; }
+
+  // Cache line write-backs make the writes durable, no msync needed
+  inline bool dax() const { return sync_mapping; }
+
+ private:
+  int fd;
+  uint8_t *buf;
+  size_t length;
+  bool sync_mapping = false;
+};
+}  // namespace dory
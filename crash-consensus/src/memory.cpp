@@ -102,6 +102,9 @@ void ScratchpadMemory::setup() {
   setupLeaderResponseSlot();
   setupLeaderHeartbeatSlot();
   setupReadLeaderHeartbeatSlots();
+  setupLeaderLeaseSlot();
+  setupFlushMarkSlot();
+  setupReadFlushMarkSlots();
 }
 
 size_t ScratchpadMemory::requiredSize() const { return next - mem.ptr; }
@@ -194,6 +197,26 @@ std::vector<ptrdiff_t>& ScratchpadMemory::readLeaderHeartbeatSlotsOffsets() {
   return read_leader_heartbeat_slots_offsets;
 }
 
+uint8_t* ScratchpadMemory::leaderLeaseSlot() { return leader_lease_slot; }
+
+ptrdiff_t ScratchpadMemory::leaderLeaseSlotOffset() {
+  return leader_lease_slot_offset;
+}
+
+uint8_t* ScratchpadMemory::flushMarkSlot() { return flush_mark_slot; }
+
+std::vector<uint8_t*>& ScratchpadMemory::readFlushMarkSlots() {
+  return read_flush_mark_slots;
+}
+
+ptrdiff_t ScratchpadMemory::flushMarkSlotOffset() {
+  return flush_mark_slot_offset;
+}
+
+std::vector<ptrdiff_t>& ScratchpadMemory::readFlushMarkSlotsOffsets() {
+  return read_flush_mark_slots_offsets;
+}
+
 void ScratchpadMemory::setupReadFUOSlots() {
   setupSlots(read_fuo_slots, read_fuo_slots_offsets);
 }
@@ -242,6 +265,18 @@ void ScratchpadMemory::setupReadLeaderHeartbeatSlots() {
   setupSlots(read_leader_heartbeat_slots, read_leader_heartbeat_slots_offsets);
 }
 
+void ScratchpadMemory::setupLeaderLeaseSlot() {
+  setupSlot(leader_lease_slot, leader_lease_slot_offset);
+}
+
+void ScratchpadMemory::setupFlushMarkSlot() {
+  setupSlot(flush_mark_slot, flush_mark_slot_offset);
+}
+
+void ScratchpadMemory::setupReadFlushMarkSlots() {
+  setupSlots(read_flush_mark_slots, read_flush_mark_slots_offsets);
+}
+
 void ScratchpadMemory::setupSlots(std::vector<uint8_t*>& slots,
                                   std::vector<ptrdiff_t>& offsets) {
   slots.resize(max_id + 1);
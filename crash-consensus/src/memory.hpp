@@ -60,6 +60,9 @@ class ScratchpadMemory {
   uint8_t *leaderResponseSlot();
   uint8_t *leaderHeartbeatSlot();
   std::vector<uint8_t *> &readLeaderHeartbeatSlots();
+  uint8_t *leaderLeaseSlot();
+  uint8_t *flushMarkSlot();
+  std::vector<uint8_t *> &readFlushMarkSlots();
 
   // Add more entries here
   std::vector<ptrdiff_t> &readFUOSlotsOffsets();
@@ -74,6 +77,9 @@ class ScratchpadMemory {
   ptrdiff_t leaderResponseSlotOffset();
   ptrdiff_t leaderHeartbeatSlotOffset();
   std::vector<ptrdiff_t> &readLeaderHeartbeatSlotsOffsets();
+  ptrdiff_t leaderLeaseSlotOffset();
+  ptrdiff_t flushMarkSlotOffset();
+  std::vector<ptrdiff_t> &readFlushMarkSlotsOffsets();
 
  private:
   ScratchpadMemory(std::vector<int> &ids, Memory const &mem);
@@ -92,6 +98,9 @@ class ScratchpadMemory {
   void setupLeaderResponseSlot();
   void setupLeaderHeartbeatSlot();
   void setupReadLeaderHeartbeatSlots();
+  void setupLeaderLeaseSlot();
+  void setupFlushMarkSlot();
+  void setupReadFlushMarkSlots();
 
   void setupSlots(std::vector<uint8_t *> &slots,
                   std::vector<ptrdiff_t> &offsets);
@@ -114,6 +123,9 @@ class ScratchpadMemory {
   uint8_t *leader_resp_slot;
   uint8_t *leader_heartbeat_slot;
   std::vector<uint8_t *> read_leader_heartbeat_slots;
+  uint8_t *leader_lease_slot;
+  uint8_t *flush_mark_slot;
+  std::vector<uint8_t *> read_flush_mark_slots;
 
   // Add more entries here
   std::vector<ptrdiff_t> read_fuo_slots_offsets;
@@ -128,6 +140,9 @@ class ScratchpadMemory {
   ptrdiff_t leader_resp_slot_offset;
   ptrdiff_t leader_heartbeat_slot_offset;
   std::vector<ptrdiff_t> read_leader_heartbeat_slots_offsets;
+  ptrdiff_t leader_lease_slot_offset;
+  ptrdiff_t flush_mark_slot_offset;
+  std::vector<ptrdiff_t> read_flush_mark_slots_offsets;
 
   Memory mem;
   uint8_t *next;
@@ -38,6 +38,10 @@ enum Kind : uint64_t {
 
   TofinoWr = 10,
 
+  SnapshotRd = 11,  // Used when reading the snapshot of another replica
+
+  FlushMarkRd = 12,  // Used by the leader to read how far followers flushed
+
   MAX = 15
 };
 
@@ -52,7 +56,9 @@ enum Kind : uint64_t {
       {Kind::LeaderReqWr, "Kind::LeaderReqWr"},
       {Kind::LeaderGrantWr, "Kind::LeaderGrantWr"},
       {Kind::LeaderHeartbeat, "Kind::LeaderHeartbeat"},
-      {Kind::TofinoWr, "Kind::TofinoWr"}};
+      {Kind::TofinoWr, "Kind::TofinoWr"},
+      {Kind::SnapshotRd, "Kind::SnapshotRd"},
+      {Kind::FlushMarkRd, "Kind::FlushMarkRd"}};
   auto it = MyEnumStrings.find(k);
   return it == MyEnumStrings.end() ? "Out of range" : it->second;
 }
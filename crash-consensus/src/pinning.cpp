@@ -19,6 +19,16 @@ void pinThreadToCore(std::thread &thd, int cpu_id) {
   }
 }
 
+void setThreadIdle(std::thread &thd) {
+  struct sched_param param;
+  param.sched_priority = 0;
+  int rc = pthread_setschedparam(thd.native_handle(), SCHED_IDLE, &param);
+  if (rc != 0) {
+    throw std::runtime_error("Error calling pthread_setschedparam: " +
+                             std::string(std::strerror(rc)));
+  }
+}
+
 void setThreadName(std::thread::native_handle_type pthread, char const *name) {
   int rc = pthread_setname_np(pthread, name);
 
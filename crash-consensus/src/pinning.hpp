@@ -5,6 +5,9 @@
 namespace dory {
 void pinThreadToCore(std::thread &thd, int cpu_id);
 
+// Only runs when nothing else wants the core (SCHED_IDLE)
+void setThreadIdle(std::thread &thd);
+
 void setThreadName(std::thread::native_handle_type pthread, char const *name);
 void setThreadName(std::thread &thd, char const *name);
 }  // namespace dory
\ No newline at end of file
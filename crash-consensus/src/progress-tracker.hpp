@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace dory {
+/*Publie l'avancement local de la réplication, pour que les lectures puissent
+être servies par n'importe quel réplica tant que son retard reste borné.
+
+Écrit par un seul thread à la fois (le follower, ou le leader dans propose :
+ils possèdent le log à tour de rôle), lu par n'importe quel thread.
+
+Une entrée trouvée dans le log à l'instant t a été postée par le leader avant
+t, et son FUO couvre tout ce que le leader avait commité à ce moment-là. Une
+fois commitée jusqu'à ce FUO, l'état local contient donc tout ce que le leader
+avait commité à t (à un délai réseau près).*/
+class ProgressTracker {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Snapshot {
+    uint64_t applied_fuo;      // Offset in the log up to which we committed
+    uint64_t applied_entries;  // Log entries committed locally, monotonic
+    uint64_t pending_entries;  // Received, but not known to be committed yet
+    uint64_t staleness_ns;     // Age of the last state known to be complete
+  };
+
+  // Called when a new entry shows up in the log
+  inline void received() {
+    received_entries.store(received_entries.load(std::memory_order_relaxed) + 1,
+                           std::memory_order_relaxed);
+  }
+
+  // Everything up to `fuo` (`entries` new log entries) was handed to the
+  // committer, and includes all that the leader had committed at `fresh_at`
+  inline void committed(uint64_t fuo, uint64_t entries,
+                        Clock::time_point fresh_at) {
+    applied_fuo.store(fuo, std::memory_order_relaxed);
+    applied_entries.store(
+        applied_entries.load(std::memory_order_relaxed) + entries,
+        std::memory_order_relaxed);
+    fresh_at_ns.store(fresh_at.time_since_epoch().count(),
+                      std::memory_order_release);
+  }
+
+  Snapshot snapshot() const {
+    Snapshot s;
+    auto fresh_at = fresh_at_ns.load(std::memory_order_acquire);
+    s.applied_fuo = applied_fuo.load(std::memory_order_relaxed);
+    s.applied_entries = applied_entries.load(std::memory_order_relaxed);
+
+    auto received = received_entries.load(std::memory_order_relaxed);
+    s.pending_entries =
+        received > s.applied_entries ? received - s.applied_entries : 0;
+
+    // Nothing committed yet: we know nothing about the leader
+    if (fresh_at == 0) {
+      s.staleness_ns = UINT64_MAX;
+    } else {
+      auto now = Clock::now().time_since_epoch().count();
+      s.staleness_ns = now > fresh_at ? static_cast<uint64_t>(now - fresh_at)
+                                      : 0;
+    }
+
+    return s;
+  }
+
+ private:
+  alignas(64) std::atomic<uint64_t> received_entries{0};
+  std::atomic<uint64_t> applied_entries{0};
+  std::atomic<uint64_t> applied_fuo{0};
+  std::atomic<Clock::rep> fresh_at_ns{0};
+};
+}  // namespace dory
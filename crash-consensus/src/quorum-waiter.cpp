@@ -120,24 +120,34 @@ template <class ID> bool SerialQuorumWaiter<ID>::fastConsume(std::vector<struct
         continue;
       }
 
-      auto current_seq = scoreboard[pid];
-      scoreboard[pid] = current_seq + modulo == seq ? seq : 0;
-
-      if (scoreboard[pid] == next_id) {
-        left -= 1;
-        ret_left = left; 
+      //les writes ne sont pas tous signalés (voir FixedSizeMajorityOperation) :
+      //comme RC les termine dans l'ordre, un wc vaut aussi pour les writes
+      //non signalés postés avant lui vers ce pid, le seq peut donc sauter
+      if (seq <= scoreboard[pid]) {
+        continue;
       }
+      scoreboard[pid] = seq;
 
-      if (left == 0) {
-        left = quorum_size;
+      int reached_next = reached(next_id);
+      while (reached_next >= quorum_size) {
         next_id += modulo;
+        reached_next = reached(next_id);
       }
+
+      left = quorum_size - reached_next;
+      ret_left = left;
     }
   }
 
   return true;
 }
 
+template <class ID> int SerialQuorumWaiter<ID>::reached(ID id) const {
+  return static_cast<int>(
+      std::count_if(scoreboard.begin(), scoreboard.end(),
+                    [id](ID i) { return i >= id; }));
+}
+
 template <class ID> inline bool SerialQuorumWaiter<ID>::canContinueWith(ID expected) const {
   return next_id >= expected;
 }
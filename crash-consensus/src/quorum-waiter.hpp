@@ -47,7 +47,7 @@ template <class ID> class SerialQuorumWaiter {
 
   /*Comme consume, mais tu indiques le nombre de wc à traiter (int num)
   et le nombre de noeuds qui n'ont pas encore atteint next_id est renseigné dans 
-  ret_left*/
+  ret_left. Un wc peut acquitter plusieurs seq d'un coup (writes non signalés)*/
   bool fastConsume(std::vector<struct ibv_wc>& entries, int num, int& ret_left);
 
 
@@ -56,6 +56,12 @@ template <class ID> class SerialQuorumWaiter {
 
   int maximumResponses() const;
 
+  //requêtes jusqu'à `posted` (comprise) dont `pid` n'a pas encore de wc
+  inline int unacknowledged(int pid, ID posted) const {
+    auto acked = scoreboard[pid];
+    return posted > acked ? static_cast<int>((posted - acked) / modulo) : 0;
+  }
+
   //reset the scoreboard for next 
   void reset(ID next);
 
@@ -73,6 +79,9 @@ template <class ID> class SerialQuorumWaiter {
 
 
  private:
+  //nombre de noeuds dont le scoreboard a atteint `id`
+  int reached(ID id) const;
+
   quorum::Kind kind; //le genre d'opération, renseigné dans la wr_id
   std::vector<ID> scoreboard;
   int quorum_size;
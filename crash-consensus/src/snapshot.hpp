@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+
+#include "log.hpp"
+
+namespace dory {
+/*Snapshot de l'état de l'application, gardé dans la mémoire enregistrée
+(shared-mr), au même offset sur toutes les répliques, pour qu'une réplique qui
+a perdu son état puisse le lire par RDMA chez une autre.
+
+Le header est un seqlock : seq est impair pendant que le snapshot change
+(écrit localement, ou lu depuis une autre réplique). Une copie distante n'est
+valide que si seq est pair et identique avant et après la lecture des données.
+
+position est la position dans l'anneau (Log::ringPosition) du FUO que le
+snapshot couvre. Les entrées qui la précèdent sont déjà dans le snapshot, les
+boucles de commit ne les donnent plus à l'application (voir covers()).*/
+class SnapshotStore {
+ public:
+  struct Header {
+    uint64_t seq;
+    uint64_t position;  // 0 if there is no snapshot
+    uint64_t applied;   // Commands the snapshot includes
+    uint64_t length;
+  };
+
+  // Serializes the state of the application in `buf` and returns its length,
+  // or anything above `capacity` if it does not fit
+  using Snapshotter = std::function<size_t(uint8_t *buf, size_t capacity)>;
+  using Restorer = std::function<void(uint8_t const *buf, size_t len)>;
+
+  SnapshotStore() : area{nullptr}, size{0}, remote_offset{0} {}
+
+  // `offset` is the offset of `area` inside the registered memory. With
+  // `resume`, a complete snapshot left in a durable area is kept, but it only
+  // covers log entries once it is restored (see Consensus::installSnapshot).
+  SnapshotStore(uint8_t *area, size_t size, uintptr_t offset,
+                bool resume = false)
+      : area{area}, size{size}, remote_offset{offset} {
+    if (size > 0 && size <= dataOffset()) {
+      throw std::runtime_error("The snapshot area is too small");
+    }
+
+    if (!enabled()) {
+      return;
+    }
+
+    auto persisted = *reinterpret_cast<Header *>(area);
+    if (resume && persisted.seq % 2 == 0 && persisted.position != 0 &&
+        persisted.length <= capacity()) {
+      local = persisted;
+    } else {
+      publish(Header{0, 0, 0, 0});
+    }
+  }
+
+  inline bool enabled() const { return size > 0; }
+  inline size_t capacity() const { return size - dataOffset(); }
+  inline uintptr_t offset() const { return remote_offset; }
+
+  inline uint8_t *data() { return area + dataOffset(); }
+  inline uint8_t *region() { return area; }
+  inline size_t regionSize() const { return size; }
+  static constexpr size_t dataOffset() {
+    return LogConfig::round_up_powerof2(2 * sizeof(Header));
+  }
+
+  // The local snapshot. Only the thread that owns the log changes it.
+  inline Header const &current() const { return local; }
+
+  // Where the header of a remote snapshot is read into
+  inline Header *remoteHeader() { return reinterpret_cast<Header *>(area) + 1; }
+
+  // The commands of the entry at `position` are in the snapshot
+  inline bool covers(uint64_t position) const {
+    return position < covered_up_to;
+  }
+
+  // The commands up to `position` reached the application another way (an
+  // imported LogStream)
+  inline void cover(uint64_t position) {
+    if (position > covered_up_to) {
+      covered_up_to = position;
+    }
+  }
+
+  bool store(Snapshotter const &f, uint64_t position, uint64_t applied) {
+    beginWrite();
+
+    auto len = f(data(), capacity());
+    if (len > capacity()) {
+      publish(Header{0, 0, 0, 0});
+      return false;
+    }
+
+    publish(Header{0, position, applied, len});
+    return true;
+  }
+
+  // The data area is about to change, remote readers have to retry
+  inline void beginWrite() {
+    auto volatile *h = reinterpret_cast<Header volatile *>(area);
+    local.seq |= 1;
+    h->seq = local.seq;
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  // Ends the write with the header `h`, its seq is ignored
+  void publish(Header const &h) {
+    auto volatile *shared = reinterpret_cast<Header volatile *>(area);
+    shared->position = h.position;
+    shared->applied = h.applied;
+    shared->length = h.length;
+    std::atomic_thread_fence(std::memory_order_release);
+
+    auto seq = local.seq;
+    local = h;
+    local.seq = (seq | 1) + 1;
+    shared->seq = local.seq;
+
+    if (h.position > covered_up_to) {
+      covered_up_to = h.position;
+    }
+  }
+
+  // A remote snapshot read between `before` and `after` is complete
+  static inline bool consistent(Header const &before, Header const &after) {
+    return before.seq % 2 == 0 && before.seq == after.seq;
+  }
+
+ private:
+  uint8_t *area;
+  size_t size;
+  uintptr_t remote_offset;
+  Header local{0, 0, 0, 0};
+  uint64_t covered_up_to = 0;
+};
+}  // namespace dory
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace dory {
+/*File bornée multi-producteurs / un seul consommateur pour soumettre des
+propositions au thread qui appelle propose().
+
+Chaque producteur réserve une position avec un fetch_add, puis attend que le
+slot correspondant soit libre. L'état du slot est encodé dans son `seq`, pour
+une position p :
+  seq == p      : libre, le producteur de p peut y écrire
+  seq == p + 1  : rempli, le consommateur peut le traiter
+  seq == p + 2  : traité, `ret` contient le résultat pour le producteur
+Le producteur libère ensuite le slot pour le tour suivant (seq = p + size).
+Le consommateur traite les positions dans l'ordre, sans mutex, et peut en
+traiter plusieurs d'un coup (group commit).*/
+class SubmissionRing {
+ public:
+  SubmissionRing(size_t size) : size{size}, mask{size - 1}, head{0}, tail{0} {
+    if (size < 4 || (size & (size - 1)) != 0) {
+      throw std::runtime_error(
+          "The submission ring size must be a power of 2 (at least 4)");
+    }
+
+    slots = std::make_unique<Slot[]>(size);
+    for (size_t i = 0; i < size; i++) {
+      slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  // Called by any producer. Blocks (spins) while the ring is full and until
+  // the consumer processed the submission, then returns its result.
+  int submit(uint8_t *buf, size_t len) {
+    auto pos = tail.fetch_add(1, std::memory_order_relaxed);
+    auto &slot = slots[pos & mask];
+
+    while (slot.seq.load(std::memory_order_acquire) != pos) {
+      ;
+    }
+
+    slot.buf = buf;
+    slot.len = len;
+    slot.seq.store(pos + 1, std::memory_order_release);
+
+    while (slot.seq.load(std::memory_order_acquire) != pos + 2) {
+      ;
+    }
+
+    auto ret = slot.ret;
+    slot.seq.store(pos + size, std::memory_order_release);
+
+    return ret;
+  }
+
+  // The functions below are called by the single consumer.
+
+  // Number of consecutive submissions ready at the head of the ring, at most
+  // `max`
+  size_t ready(size_t max) const {
+    size_t n = 0;
+    while (n < max) {
+      auto pos = head + n;
+      if (slots[pos & mask].seq.load(std::memory_order_acquire) != pos + 1) {
+        break;
+      }
+      n++;
+    }
+
+    return n;
+  }
+
+  // The i-th ready submission, counting from the head
+  inline std::pair<uint8_t *, size_t> peek(size_t i) const {
+    auto &slot = slots[(head + i) & mask];
+    return std::make_pair(slot.buf, slot.len);
+  }
+
+  // Hands `ret` back to the producers of the first `n` ready submissions
+  void complete(size_t n, int ret) {
+    for (size_t i = 0; i < n; i++, head++) {
+      auto &slot = slots[head & mask];
+      slot.ret = ret;
+      slot.seq.store(head + 2, std::memory_order_release);
+    }
+  }
+
+ private:
+  struct alignas(64) Slot {
+    std::atomic<uint64_t> seq;
+    uint8_t *buf;
+    size_t len;
+    int ret;
+  };
+
+  size_t const size;
+  size_t const mask;
+  std::unique_ptr<Slot[]> slots;
+
+  uint64_t head;  // Only touched by the consumer
+  alignas(64) std::atomic<uint64_t> tail;
+};
+}  // namespace dory
@@ -1,5 +1,13 @@
+#include <cerrno>
+#include <algorithm>
 #include <cstring>
 #include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <linux/mman.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 #include "block.hpp"
 #include "device.hpp"
@@ -8,6 +16,28 @@ namespace dory {
 /*ControlBlock::ControlBlock()
     : LOGGER_INIT(logger, "CB") {}*/
 
+// Writes a zero in every page, the kernel backs each of them with a zeroed
+// page on the first write
+static void populate(uint8_t *buf, size_t length, size_t page_size,
+                     int threads) {
+  size_t pages = (length + page_size - 1) / page_size;
+  size_t per_thread = (pages + threads - 1) / threads;
+
+  std::vector<std::thread> workers;
+  for (size_t first = 0; first < pages; first += per_thread) {
+    size_t last = std::min(pages, first + per_thread);
+    workers.emplace_back([buf, page_size, first, last]() noexcept {
+      for (size_t i = first; i < last; i++) {
+        *reinterpret_cast<uint8_t volatile *>(buf + i * page_size) = 0;
+      }
+    });
+  }
+
+  for (auto &w : workers) {
+    w.join();
+  }
+}
+
 ControlBlock::ControlBlock(ResolvedPort &resolved_port)
     : resolved_port{resolved_port}, LOGGER_INIT(logger, "CB") {}
 
@@ -48,14 +78,66 @@ deleted_unique_ptr<struct ibv_pd> &ControlBlock::pd(std::string name) {
 }
 
 void ControlBlock::allocateBuffer(std::string name, size_t length,
-                                  int alignment) {
+                                  int alignment, PageSize pages,
+                                  int populate_threads) {
   if (buf_map.find(name) != buf_map.end()) {
     throw std::runtime_error("Already registered protection domain named " +
                              name); //"protection domain" ? Ca devrait plutôt être "buffer name" je pense
   }
 
-  std::unique_ptr<uint8_t[], DeleteAligned<uint8_t>> data(allocate_aligned<uint8_t>(alignment, length));
-  memset(data.get(), 0, length);
+  deleted_unique_ptr<uint8_t> data;
+  size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+  if (pages != RegularPages) {
+    // Les pages sont alignées sur leur taille, donc au moins sur `alignment`
+    size_t huge_page_size =
+        pages == HugePages1GiB ? (1UL << 30) : (1UL << 21);
+    int page_flag = pages == HugePages1GiB ? MAP_HUGE_1GB : MAP_HUGE_2MB;
+    size_t mapped_len =
+        (length + huge_page_size - 1) / huge_page_size * huge_page_size;
+
+    void *mem = mmap(nullptr, mapped_len, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | page_flag, -1,
+                     0);
+
+    if (mem == MAP_FAILED) {
+      LOGGER_WARN(logger,
+                  "Could not back buffer '{}' with huge pages ({}), falling "
+                  "back to regular pages",
+                  name, std::strerror(errno));
+    } else {
+      // Anonymous mappings are already zeroed
+      page_size = huge_page_size;
+      data = deleted_unique_ptr<uint8_t>(
+          reinterpret_cast<uint8_t *>(mem),
+          [mapped_len](uint8_t *p) noexcept { munmap(p, mapped_len); });
+    }
+  }
+
+  if (!data && static_cast<size_t>(alignment) <= page_size) {
+    size_t mapped_len = (length + page_size - 1) / page_size * page_size;
+    void *mem = mmap(nullptr, mapped_len, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (mem == MAP_FAILED) {
+      throw std::runtime_error("Could not allocate buffer " + name + ": " +
+                               std::strerror(errno));
+    }
+
+    data = deleted_unique_ptr<uint8_t>(
+        reinterpret_cast<uint8_t *>(mem),
+        [mapped_len](uint8_t *p) noexcept { munmap(p, mapped_len); });
+  }
+
+  if (!data) {
+    // Alignment beyond a page, memset populates the pages anyway
+    auto aligned = allocate_aligned<uint8_t>(alignment, length);
+    memset(aligned.get(), 0, length);
+    data = deleted_unique_ptr<uint8_t>(aligned.release(),
+                                       [](uint8_t *p) noexcept { free(p); });
+  } else if (populate_threads > 0) {
+    populate(data.get(), length, page_size, populate_threads);
+  }
 
   raw_bufs.push_back(std::move(data));
 
@@ -147,6 +229,40 @@ void ControlBlock::registerMR(std::string name, std::string pd_name,
 }
 
 
+void ControlBlock::registerExternalMR(std::string name, std::string pd_name,
+                                      void *buf, size_t buf_len,
+                                      MemoryRights rights) {
+  if (mr_map.find(name) != mr_map.end()) {
+    throw std::runtime_error("Already registered memory region named " + name);
+  }
+  auto pd = pd_map.find(pd_name);
+  if (pd == pd_map.end()) {
+    throw std::runtime_error("No PD exists with name " + pd_name);
+  }
+
+  auto mr = ibv_reg_mr(pds[pd->second].get(), buf, buf_len,
+                       static_cast<int>(rights));
+
+  if (mr == nullptr) {
+    throw std::runtime_error("Could not register the memory region " + name);
+  }
+
+  deleted_unique_ptr<struct ibv_mr> uniq_mr(mr, [](struct ibv_mr *mr) {
+    auto ret = ibv_dereg_mr(mr);
+    if (ret != 0) {
+      throw std::runtime_error("Could not query device: " +
+                               std::string(std::strerror(errno)));
+    }
+  });
+
+  mrs.push_back(std::move(uniq_mr));
+  mr_map.insert(std::pair<std::string, size_t>(name, mrs.size() - 1));
+  LOGGER_INFO(logger,
+              "MR '{}' under PD '{}' registered with external buf (address: "
+              "0x{:x}, length: {}) and rights {}",
+              name, pd_name, uintptr_t(buf), buf_len, rights);
+}
+
 //Quand on lui demande la memory region, il va crée un objet spécialement 
 //(MemoryRegion) pour nous indiquer les champs pertinents 
 ControlBlock::MemoryRegion ControlBlock::mr(std::string name) const {
@@ -167,13 +283,19 @@ ControlBlock::MemoryRegion ControlBlock::mr(std::string name) const {
 }
 
 
-void ControlBlock::registerCQ(std::string name) {
+void ControlBlock::registerCQ(std::string name, int depth) {
   if (cq_map.find(name) != cq_map.end()) {
     throw std::runtime_error("Already registered protection domain named " +
                              name);
   }
 
-  auto cq = ibv_create_cq(resolved_port.device().context(), CQDepth, nullptr,
+  if (depth <= 0 || depth > maxCQDepth()) {
+    throw std::runtime_error("The completion queue " + name + " cannot be " +
+                             std::to_string(depth) + " deep (the device " +
+                             "allows " + std::to_string(maxCQDepth()) + ")");
+  }
+
+  auto cq = ibv_create_cq(resolved_port.device().context(), depth, nullptr,
                           nullptr, 0);
 
   if (cq == nullptr) {
@@ -190,7 +312,7 @@ void ControlBlock::registerCQ(std::string name) {
 
   cqs.push_back(std::move(uniq_cq));
   cq_map.insert(std::pair<std::string, size_t>(name, cqs.size() - 1));
-  LOGGER_INFO(logger, "CQ '{}' registered", name);
+  LOGGER_INFO(logger, "CQ '{}' registered ({} deep)", name, depth);
 }
 
 deleted_unique_ptr<struct ibv_cq> &ControlBlock::cq(std::string name) {
@@ -207,6 +329,14 @@ deleted_unique_ptr<struct ibv_cq> &ControlBlock::cq(std::string name) {
 int ControlBlock::port() const { return resolved_port.portID(); }
 int ControlBlock::lid() const { return resolved_port.portLID(); }
 
+int ControlBlock::maxCQDepth() const {
+  return resolved_port.device().device_attributes().max_cqe;
+}
+
+int ControlBlock::maxQPDepth() const {
+  return resolved_port.device().device_attributes().max_qp_wr;
+}
+
 bool ControlBlock::pollCqIsOK(deleted_unique_ptr<struct ibv_cq> &cq,
                               std::vector<struct ibv_wc> &entries) {
   auto num =
@@ -35,6 +35,20 @@ class ControlBlock {
     uint32_t rkey;
   };
 
+  /**
+   * Pages backing a buffer allocated with `allocateBuffer`.
+   *
+   * Huge pages reduce the address translations the RDMA device does on large
+   * registered buffers. When the system has no huge pages to spare, the
+   * allocation falls back to regular pages.
+   *
+   * Buffers are anonymous mappings, hence zeroed by construction. With
+   * `populate_threads` > 0, their pages are faulted in by that many threads
+   * in parallel: registering the buffer would otherwise fault them in one at
+   * a time.
+   **/
+  enum PageSize { RegularPages, HugePages2MiB, HugePages1GiB };
+
   static constexpr int CQDepth = 128;
 
   //ControlBlock();
@@ -45,7 +59,8 @@ class ControlBlock {
 
   deleted_unique_ptr<struct ibv_pd> &pd(std::string name);
 
-  void allocateBuffer(std::string name, size_t length, int alignment);
+  void allocateBuffer(std::string name, size_t length, int alignment,
+                      PageSize pages = RegularPages, int populate_threads = 0);
 
   void registerMR(std::string name, std::string pd_name,
                   std::string buffer_name, size_t offset, size_t buf_len,
@@ -53,15 +68,25 @@ class ControlBlock {
 
   void registerMR(std::string name, std::string pd_name,
                   std::string buffer_name, MemoryRights rights = LOCAL_READ);
+
+  // Registers memory owned by the application (not allocated with
+  // allocateBuffer), e.g. buffers it wants to send from without a copy
+  void registerExternalMR(std::string name, std::string pd_name, void *buf,
+                          size_t buf_len, MemoryRights rights = LOCAL_READ);
   // void withdrawMRRight(std::string name) const;
   MemoryRegion mr(std::string name) const;
 
-  void registerCQ(std::string name);
+  // `depth` completions at most, up to what the device allows (maxCQDepth)
+  void registerCQ(std::string name, int depth = CQDepth);
   deleted_unique_ptr<struct ibv_cq> &cq(std::string name);
 
   int port() const;
   int lid() const;
 
+  // Limits of the device on the depth of a CQ and of a send/receive queue
+  int maxCQDepth() const;
+  int maxQPDepth() const;
+
   static bool pollCqIsOK(deleted_unique_ptr<struct ibv_cq> &cq,
                          std::vector<struct ibv_wc> &entries);
 
@@ -71,7 +96,7 @@ class ControlBlock {
   std::vector<deleted_unique_ptr<struct ibv_pd>> pds; 
   std::map<std::string, size_t> pd_map; //le nom (string) et l'indice correspondant 
 
-  std::vector<std::unique_ptr<uint8_t[], DeleteAligned<uint8_t>>> raw_bufs;
+  std::vector<deleted_unique_ptr<uint8_t>> raw_bufs;
   std::map<std::string, std::pair<size_t, size_t>> buf_map;
   //string = nom du buffer, et la paire = (indice du buffer dans le vecteur; taille du buffer)
 
@@ -125,6 +125,7 @@ class ResolvedPort {
   uint16_t portLID() const { return port_lid; }
 
   OpenDevice &device() { return open_dev; }
+  OpenDevice const &device() const { return open_dev; }
 
  private:
   static std::string link_layer_str(uint8_t link_layer) {